@@ -0,0 +1,328 @@
+/* ----------------------------------------------------------------------------
+lick-reload.cc
+
+Copyright 2017 Jason Lucas (JasonL9000@gmail.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+---------------------------------------------------------------------------- */
+
+/* A driver which stays resident, loads test modules built as shared objects,
+   and runs their fixtures again whenever one of them is rebuilt.  Build it
+   from this file and lick.cc, the latter with LICK_NO_MAIN, exporting lick's
+   symbols to the modules, like this:
+     c++ -std=c++14 -pthread -DLICK_NO_MAIN -rdynamic \
+         -o lick-reload lick.cc lick-reload.cc -ldl
+   See "Reloading Test Modules" in README.md. */
+
+#include "lick.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lick {
+
+// Identifies a version of a file.  Rewriting or replacing the file changes
+// its stamp.  A missing file's stamp is all zeros.
+struct stamp_t final {
+
+  bool operator==(const stamp_t &that) const noexcept {
+    return dev == that.dev && ino == that.ino && size == that.size
+        && mtime_ns == that.mtime_ns;
+  }
+
+  bool operator!=(const stamp_t &that) const noexcept {
+    return !(*this == that);
+  }
+
+  static stamp_t of(const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) {
+      return stamp_t { 0, 0, 0, 0 };
+    }
+    return stamp_t {
+      static_cast<std::uint64_t>(st.st_dev),
+      static_cast<std::uint64_t>(st.st_ino),
+      static_cast<std::uint64_t>(st.st_size),
+      static_cast<std::uint64_t>(st.st_mtim.tv_sec) * 1000000000
+          + static_cast<std::uint64_t>(st.st_mtim.tv_nsec)
+    };
+  }
+
+  std::uint64_t dev, ino, size, mtime_ns;
+
+};  // stamp_t
+
+// Finds the records of the fixtures in a shared object loaded from the given
+// file.  The linker bounds the records' section with symbols, as it does in
+// a program, but those are private to the object, so the section is found
+// by name in the file's section headers instead, and located by where the
+// object was loaded.
+static fixture_t::span_t find_span(const std::string &path, void *handle) {
+  fixture_t::span_t span { nullptr, nullptr };
+  std::ifstream file { path, std::ios::binary };
+  ElfW(Ehdr) ehdr;
+  if (!file.read(reinterpret_cast<char *>(&ehdr), sizeof(ehdr))
+      || std::memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0) {
+    throw std::runtime_error { path + " is not an ELF file" };
+  }
+  std::vector<ElfW(Shdr)> shdrs(ehdr.e_shnum);
+  file.seekg(static_cast<std::streamoff>(ehdr.e_shoff));
+  file.read(
+      reinterpret_cast<char *>(shdrs.data()),
+      static_cast<std::streamsize>(shdrs.size() * sizeof(ElfW(Shdr))));
+  if (!file || ehdr.e_shstrndx >= shdrs.size()) {
+    return span;
+  }
+  const auto &names_hdr = shdrs[ehdr.e_shstrndx];
+  std::string names(names_hdr.sh_size, '\0');
+  file.seekg(static_cast<std::streamoff>(names_hdr.sh_offset));
+  file.read(&names[0], static_cast<std::streamsize>(names.size()));
+  if (!file) {
+    return span;
+  }
+  for (const auto &shdr : shdrs) {
+    if (shdr.sh_name >= names.size()
+        || std::strcmp(names.c_str() + shdr.sh_name, "lick_fixtures") != 0) {
+      continue;
+    }
+    link_map *map = nullptr;
+    if (dlinfo(handle, RTLD_DI_LINKMAP, &map) < 0 || !map) {
+      throw std::runtime_error { dlerror() };
+    }
+    span.start = reinterpret_cast<const fixture_t *>(
+        map->l_addr + shdr.sh_addr);
+    span.stop = span.start + shdr.sh_size / sizeof(fixture_t);
+    break;
+  }  // for
+  return span;
+}
+
+// Copies a file to a new temporary one and returns the latter's path.
+static std::string copy_to_temp(const std::string &path) {
+  const char *dir = getenv("TMPDIR");
+  std::string temp_path = std::string { (dir && *dir) ? dir : "/tmp" }
+      + "/lick-reload-XXXXXX";
+  int fd = mkstemp(&temp_path[0]);
+  if (fd < 0) {
+    throw std::system_error {
+      errno, std::system_category(), "mkstemp " + temp_path
+    };
+  }
+  close(fd);
+  std::ifstream in { path, std::ios::binary };
+  std::ofstream out { temp_path, std::ios::binary | std::ios::trunc };
+  out << in.rdbuf();
+  out.close();
+  if (!in || !out) {
+    unlink(temp_path.c_str());
+    throw std::runtime_error { "could not copy " + path };
+  }
+  return temp_path;
+}
+
+// A test module: a shared object of fixtures.  It's loaded from a private
+// copy, since the loader would hand back what it already has for a path it
+// has seen, and since the build may rewrite the file in place at any time.
+class module_t final {
+public:
+
+  explicit module_t(std::string path_)
+      : path(std::move(path_)), stamp { 0, 0, 0, 0 }, is_tried(false),
+        handle(nullptr), span { nullptr, nullptr } {}
+
+  module_t(const module_t &) = delete;
+
+  ~module_t() {
+    unload();
+  }
+
+  module_t &operator=(const module_t &) = delete;
+
+  // True if the file has changed since it was last loaded, or if it's never
+  // been loaded.
+  bool has_changed() const {
+    return !is_tried || stamp_t::of(path) != stamp;
+  }
+
+  // Loads the current version of the file, writing why to std::cerr and
+  // returning false if it can't.  Either way, it won't be loaded again until
+  // it changes.  Symbols the module defines are visible to those loaded
+  // after it.
+  bool load() {
+    unload();
+    is_tried = true;
+    stamp = stamp_t::of(path);
+    auto stalled = stall(
+      [&] {
+        auto temp_path = copy_to_temp(path);
+        handle = dlopen(temp_path.c_str(), RTLD_NOW | RTLD_GLOBAL);
+        if (!handle) {
+          unlink(temp_path.c_str());
+          throw std::runtime_error { dlerror() };
+        }
+        auto found = stall(find_span, temp_path, handle);
+        unlink(temp_path.c_str());
+        if (!found) {
+          throw std::runtime_error { found.msg };
+        }
+        span = *found.ret;
+      }
+    );
+    if (!stalled) {
+      unload();
+      std::cerr << path << separator << stalled.msg << std::endl;
+    }
+    return stalled;
+  }
+
+  // Unloads the module, if it's loaded, which tears down its resources.
+  void unload() noexcept {
+    if (handle) {
+      dlclose(handle);
+      handle = nullptr;
+    }
+    span = fixture_t::span_t { nullptr, nullptr };
+  }
+
+  const std::string &get_path() const noexcept {
+    return path;
+  }
+
+  bool is_loaded() const noexcept {
+    return handle != nullptr;
+  }
+
+  const fixture_t::span_t &get_span() const noexcept {
+    return span;
+  }
+
+private:
+
+  std::string path;
+
+  // The version last loaded, or tried.
+  stamp_t stamp;
+
+  bool is_tried;
+
+  void *handle;
+
+  fixture_t::span_t span;
+
+};  // module_t
+
+// Loads the modules named on the command line and runs their fixtures, then
+// waits for any of them to change, reloads it and those after it, and runs
+// the fixtures again, for as long as it's left to.
+static int reload(int argc, char *argv[]) {
+  /* How often to look for changes, and how long a changed module must go
+     unchanged before it's loaded, so that a half-written one isn't. */
+  static const auto poll_time = std::chrono::milliseconds { 100 };
+  static const auto settle_time = std::chrono::milliseconds { 250 };
+  cfg_t cfg;
+  if (!cfg_t::parse(cfg, argc, argv)) {
+    return EXIT_FAILURE;
+  }
+  if (optind >= argc) {
+    std::cerr
+        << "usage: " << argv[0] << " [option]... module.so..." << std::endl;
+    return EXIT_FAILURE;
+  }
+  /* A report file holds a single run, and each run would only append
+     another to it. */
+  if (!cfg.get_reporters().empty()) {
+    std::cerr
+        << argv[0] << ": --junit and --json aren't supported" << std::endl;
+    return EXIT_FAILURE;
+  }
+  /* The cache is keyed on the build of the running program, which here is
+     the driver, so a rebuilt module would skip fixtures which passed before
+     its change. */
+  if (!cfg.get_cache_path().empty()) {
+    std::cerr << argv[0] << ": --cache isn't supported" << std::endl;
+    return EXIT_FAILURE;
+  }
+  cfg.set_keeps_resources(true);
+  std::deque<module_t> modules;
+  for (int i = optind; i < argc; ++i) {
+    modules.emplace_back(argv[i]);
+  }  // for
+  for (;;) {
+    std::size_t first = 0;
+    while (first < modules.size() && !modules[first].has_changed()) {
+      ++first;
+    }  // while
+    if (first == modules.size()) {
+      std::this_thread::sleep_for(poll_time);
+      continue;
+    }
+    std::vector<stamp_t> stamps;
+    for (;;) {
+      std::vector<stamp_t> settled;
+      for (std::size_t i = first; i < modules.size(); ++i) {
+        settled.push_back(stamp_t::of(modules[i].get_path()));
+      }  // for
+      if (settled == stamps) {
+        break;
+      }
+      stamps = std::move(settled);
+      std::this_thread::sleep_for(settle_time);
+    }  // for
+    /* A module may use what those before it define, so everything after a
+       changed module reloads with it, in reverse order for unloading. */
+    for (auto i = modules.size(); i-- > first; ) {
+      modules[i].unload();
+    }  // for
+    for (auto i = first; i < modules.size(); ++i) {
+      modules[i].load();
+    }  // for
+    std::vector<fixture_t::span_t> spans;
+    for (const auto &module : modules) {
+      if (module.is_loaded()) {
+        spans.push_back(module.get_span());
+      }
+    }  // for
+    fixture_t::set_records(spans);
+    auto stalled = stall(run_fixtures, cfg);
+    if (!stalled) {
+      std::cerr << stalled.msg << std::endl;
+    }
+    if (cfg.get_verbosity() >= 1) {
+      std::cout << "waiting for changes" << std::endl;
+    }
+  }  // for
+}
+
+}  // lick
+
+int main(int argc, char *argv[]) {
+  auto stalled = lick::stall(lick::reload, argc, argv);
+  if (!stalled) {
+    std::cerr << stalled.msg << std::endl;
+    return EXIT_FAILURE;
+  }
+  return *stalled.ret;
+}
@@ -0,0 +1,389 @@
+/* ----------------------------------------------------------------------------
+lick-run.cc
+
+Copyright 2017 Jason Lucas (JasonL9000@gmail.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+---------------------------------------------------------------------------- */
+
+/* A driver which finds lick test programs, runs many of them at once, the
+   longest first, and sums up their results as one run.  Build it from this
+   file and lick.cc, the latter with LICK_NO_MAIN, like this:
+     c++ -std=c++14 -pthread -DLICK_NO_MAIN -o lick-run lick.cc lick-run.cc
+   See "Running Many Test Programs" in README.md. */
+
+#include "lick.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace lick {
+
+// A test program to run, and what came of running it.
+struct program_t final {
+
+  std::string path;
+
+  // The time the program took when it last ran, or 0 if it never has.
+  double last_wall;
+
+  double wall;
+
+  // Everything the program wrote to its standard output and error.
+  std::string output;
+
+  int status;
+
+  // The counts from the end of the program's JSON report.  The program
+  // counts as one more failure if it wrote no such counts, or if it didn't
+  // exit as they say it should have.
+  summary_t summary;
+
+  bool has_summary;
+
+};  // program_t
+
+// Adds the programs under the path to 'paths': the path itself, if it's a
+// file, or else every executable file beneath it whose name matches the
+// pattern.
+static void find_programs(
+    const std::string &path, const std::string &pattern,
+    std::vector<std::string> &paths) {
+  struct stat st;
+  if (stat(path.c_str(), &st) < 0) {
+    throw std::system_error {
+      errno, std::system_category(), "stat " + path
+    };
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    paths.push_back(path);
+    return;
+  }
+  auto *dir = opendir(path.c_str());
+  if (!dir) {
+    throw std::system_error {
+      errno, std::system_category(), "opendir " + path
+    };
+  }
+  std::vector<std::string> names;
+  while (auto *entry = readdir(dir)) {
+    if (std::strcmp(entry->d_name, ".") && std::strcmp(entry->d_name, "..")) {
+      names.push_back(entry->d_name);
+    }
+  }  // while
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+  for (const auto &name : names) {
+    auto sub_path = path + '/' + name;
+    if (stat(sub_path.c_str(), &st) < 0) {
+      continue;
+    }
+    if (S_ISDIR(st.st_mode)) {
+      find_programs(sub_path, pattern, paths);
+    } else if (S_ISREG(st.st_mode) && access(sub_path.c_str(), X_OK) == 0
+        && fnmatch(pattern.c_str(), name.c_str(), 0) == 0) {
+      paths.push_back(sub_path);
+    }
+  }  // for
+}
+
+// Reads the counts from the end record of a lick JSON report.
+static bool read_summary(const std::string &path, summary_t &summary) {
+  std::ifstream strm { path };
+  std::string line;
+  bool found = false;
+  while (std::getline(strm, line)) {
+    char ok[6] = {};
+    if (std::sscanf(
+        line.c_str(),
+        "{\"type\":\"end\",\"passed\":%d,\"failed\":%d,\"skipped\":%d,"
+        "\"cached\":%d,\"ok\":%5[a-z],\"elapsed\":%lf}",
+        &summary.pass_cnt, &summary.fail_cnt, &summary.skip_cnt,
+        &summary.cache_cnt, ok, &summary.elapsed) == 6) {
+      summary.ok = (std::strcmp(ok, "true") == 0);
+      found = true;
+    }
+  }  // while
+  return found;
+}
+
+// Runs the programs, up to 'jobs' at a time, in the order given, each with
+// the given arguments and its output captured.  Calls 'on_done' with each
+// program as it finishes.
+static void run_programs(
+    std::vector<program_t> &programs, int jobs,
+    const std::vector<std::string> &args,
+    const std::function<void (program_t &)> &on_done) {
+  struct child_t final {
+    program_t *program;
+    pid_t pid;
+    int fd;
+    std::string json_path;
+    double start_time;
+  };
+  std::vector<child_t> children;
+  std::size_t next = 0;
+  const char *tmp_dir = getenv("TMPDIR");
+  std::string tmp_dir_path = (tmp_dir && *tmp_dir) ? tmp_dir : "/tmp";
+  while (next < programs.size() || !children.empty()) {
+    while (next < programs.size()
+        && children.size() < static_cast<std::size_t>(jobs)) {
+      auto &program = programs[next++];
+      auto json_path = tmp_dir_path + "/lick-run-XXXXXX";
+      int json_fd = mkstemp(&json_path[0]);
+      if (json_fd < 0) {
+        throw std::system_error {
+          errno, std::system_category(), "mkstemp " + json_path
+        };
+      }
+      close(json_fd);
+      std::vector<std::string> argv_strs { program.path };
+      argv_strs.insert(argv_strs.end(), args.begin(), args.end());
+      argv_strs.push_back("--json");
+      argv_strs.push_back(json_path);
+      std::vector<char *> argv;
+      for (auto &str : argv_strs) {
+        argv.push_back(&str[0]);
+      }  // for
+      argv.push_back(nullptr);
+      int fds[2];
+      if (pipe2(fds, O_CLOEXEC) < 0) {
+        throw std::system_error { errno, std::system_category(), "pipe" };
+      }
+      std::cout.flush();
+      pid_t pid = fork();
+      if (pid < 0) {
+        throw std::system_error { errno, std::system_category(), "fork" };
+      }
+      if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        execv(argv[0], argv.data());
+        dprintf(STDERR_FILENO, "exec: %s\n", strerror(errno));
+        _exit(127);
+      }
+      close(fds[1]);
+      children.push_back(
+          child_t { &program, pid, fds[0], json_path, get_wall_time() });
+    }  // while
+    std::vector<pollfd> pollfds;
+    for (const auto &child : children) {
+      pollfds.push_back(pollfd { child.fd, POLLIN, 0 });
+    }  // for
+    if (poll(pollfds.data(), pollfds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error { errno, std::system_category(), "poll" };
+    }
+    for (std::size_t i = children.size(); i-- > 0; ) {
+      if (!pollfds[i].revents) {
+        continue;
+      }
+      auto &child = children[i];
+      char buf[65536];
+      auto size = read(child.fd, buf, sizeof(buf));
+      if (size > 0) {
+        child.program->output.append(buf, static_cast<std::size_t>(size));
+        continue;
+      }
+      if (size < 0 && errno == EINTR) {
+        continue;
+      }
+      /* The pipe has closed, so the program is done, or nearly. */
+      close(child.fd);
+      int status = 0;
+      while (waitpid(child.pid, &status, 0) < 0 && errno == EINTR) {}
+      auto &program = *child.program;
+      program.wall = get_wall_time() - child.start_time;
+      program.status = status;
+      program.has_summary = read_summary(child.json_path, program.summary);
+      unlink(child.json_path.c_str());
+      children.erase(children.begin() + static_cast<std::ptrdiff_t>(i));
+      on_done(program);
+    }  // for
+  }  // while
+}
+
+static int run(int argc, char *argv[]) {
+  static const option long_opts[] = {
+    { "history", required_argument, nullptr, 'h' },
+    { "pattern", required_argument, nullptr, 'p' },
+    { nullptr, 0, nullptr, 0 }
+  };
+  int jobs = static_cast<int>(std::thread::hardware_concurrency());
+  bool strict = false;
+  std::string history_path, pattern = "*-test";
+  /* The leading '+' stops the options at the first path, so that the
+     programs' own options can follow '--' untouched. */
+  for (;;) {
+    int opt = getopt_long(argc, argv, "+j:s", long_opts, nullptr);
+    if (opt < 0) {
+      break;
+    }
+    switch (opt) {
+      case 'j': {
+        int val = atoi(optarg);
+        jobs = (val > 0) ? val : jobs;
+        break;
+      }
+      case 's': {
+        strict = true;
+        break;
+      }
+      case 'h': {
+        history_path = optarg;
+        break;
+      }
+      case 'p': {
+        pattern = optarg;
+        break;
+      }
+      default: {
+        return EXIT_FAILURE;
+      }
+    }
+  }  // for
+  std::vector<std::string> paths, args;
+  int arg_idx = optind;
+  for (; arg_idx < argc && std::strcmp(argv[arg_idx], "--"); ++arg_idx) {
+    find_programs(argv[arg_idx], pattern, paths);
+  }  // for
+  if (arg_idx == optind) {
+    std::cerr
+        << "usage: " << argv[0]
+        << " [option]... path... [-- program option...]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (++arg_idx; arg_idx < argc; ++arg_idx) {
+    args.push_back(argv[arg_idx]);
+  }  // for
+  /* The history is lick's own, by the programs' paths rather than the
+     fixtures' names. */
+  history_t history;
+  if (!history_path.empty()) {
+    history.load(history_path);
+  }
+  std::vector<program_t> programs;
+  for (const auto &path : paths) {
+    programs.push_back(program_t {
+      path, history.get(path), 0, {}, 0, summary_t { 0, 0, 0, 0, false, 0 },
+      false
+    });
+  }  // for
+  /* The longest programs start first, so that none of them is left running
+     alone at the end.  A program with no history might be long, so those
+     start before all the others. */
+  std::stable_sort(
+      programs.begin(), programs.end(),
+      [](const program_t &lhs, const program_t &rhs) {
+        return (lhs.last_wall == 0 && rhs.last_wall != 0)
+            || (rhs.last_wall != 0 && lhs.last_wall > rhs.last_wall);
+      });
+  auto start_time = get_wall_time();
+  int pass_cnt = 0, fail_cnt = 0, skip_cnt = 0, cache_cnt = 0;
+  std::vector<const program_t *> failures;
+  run_programs(
+    programs, jobs, args,
+    [&](program_t &program) {
+      /* A program which isn't a lick test program, or which crashed or
+         exited other than as its report says it should, even after writing
+         the report, counts as a failure of its own, beyond any it
+         reported. */
+      const auto &summary = program.summary;
+      bool exited_cleanly = program.has_summary && WIFEXITED(program.status)
+          && WEXITSTATUS(program.status)
+              == (summary.ok ? EXIT_SUCCESS : EXIT_FAILURE);
+      bool ok = exited_cleanly && summary.fail_cnt == 0;
+      if (program.has_summary) {
+        pass_cnt += summary.pass_cnt;
+        fail_cnt += summary.fail_cnt;
+        skip_cnt += summary.skip_cnt;
+        cache_cnt += summary.cache_cnt;
+      }
+      if (!exited_cleanly) {
+        ++fail_cnt;
+      }
+      if (!ok) {
+        failures.push_back(&program);
+      }
+      /* The program's output goes out in one piece, after a line saying how
+         it went, so that the programs' outputs don't interleave. */
+      std::ostringstream strm;
+      strm
+          << bold << program.path << plain << separator << pf_t { ok }
+          << separator << dur_t { program.wall } << " wall";
+      if (!exited_cleanly) {
+        strm << separator << get_status_msg(program.status);
+      }
+      strm << '\n' << program.output;
+      if (!program.output.empty() && program.output.back() != '\n') {
+        strm << '\n';
+      }
+      std::cout << strm.str() << std::flush;
+      history.set(program.path, program.wall);
+    }
+  );
+  bool ok = strict
+      ? (pass_cnt + cache_cnt != 0 && fail_cnt == 0)
+      : (fail_cnt == 0);
+  for (const auto *program : failures) {
+    std::cout
+        << pf_t { false } << separator << bold << program->path << plain
+        << '\n';
+  }  // for
+  std::cout
+      << "ran " << programs.size()
+      << ((programs.size() == 1) ? " program" : " programs") << separator
+      << dur_t { get_wall_time() - start_time } << " wall" << '\n'
+      << "passed " << pass_cnt << separator
+      << "failed " << fail_cnt << separator
+      << "skipped " << skip_cnt << separator;
+  if (cache_cnt) {
+    std::cout << "cached " << cache_cnt << separator;
+  }
+  std::cout << pf_t { ok } << std::endl;
+  if (!history_path.empty()) {
+    history.save(history_path);
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}  // lick
+
+int main(int argc, char *argv[]) {
+  auto stalled = lick::stall(lick::run, argc, argv);
+  if (!stalled) {
+    std::cerr << stalled.msg << std::endl;
+    return EXIT_FAILURE;
+  }
+  return *stalled.ret;
+}
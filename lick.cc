@@ -16,8 +16,44 @@ limitations under the License.
 
 #include "lick.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
 
+#include <fcntl.h>
+#include <getopt.h>
+#include <linux/futex.h>
+#include <linux/perf_event.h>
+#include <link.h>
+#include <malloc.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 namespace lick {
@@ -43,252 +79,4857 @@ static void write_ex(
   }
 }
 
-std::string get_ex_msg(const std::exception &ex) {
-  std::ostringstream strm;
-  write_ex(strm, ex);
-  return strm.str();
+std::ostream &operator<<(std::ostream &strm, const dur_t &that) {
+  static const struct {
+    double scale;
+    const char *unit;
+  } units[] = { { 1, "s" }, { 1e3, "ms" }, { 1e6, "us" }, { 1e9, "ns" } };
+  std::size_t i = 0;
+  while (i < 3 && that.secs * units[i].scale < 1) {
+    ++i;
+  }
+  std::ostringstream text;
+  text << std::setprecision(4) << (that.secs * units[i].scale) << ' '
+      << units[i].unit;
+  return strm << text.str();
 }
 
-const std::string &get_ex_msg() {
-  static const std::string ex_msg = "non-standard exception";
-  return ex_msg;
+double get_wall_time() {
+  return std::chrono::duration<double> {
+    std::chrono::steady_clock::now().time_since_epoch()
+  }.count();
 }
 
-cfg_t::cfg_t()
-    : strm(&std::cout), regex(".*"), verbosity(1), strict(false) {}
+// The CPU time used so far by the calling thread, in seconds.
+static double get_cpu_time() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
 
-bool cfg_t::parse(cfg_t &cfg, int argc, char *argv[]) {
-  bool ok = true;
-  do {
-    int opt = getopt(argc, argv, "n:sv:");
-    if (opt < 0) {
-      break;
+durations_t::durations_t(std::vector<double> secs_, int warmup_cnt_)
+    : secs(std::move(secs_)), warmup_cnt(warmup_cnt_) {
+  std::sort(secs.begin(), secs.end());
+}
+
+double durations_t::get_percentile(double pct) const noexcept {
+  if (secs.empty()) {
+    return 0;
+  }
+  pct = (pct < 0) ? 0 : (pct > 100) ? 100 : pct;
+  double rank = pct / 100 * static_cast<double>(secs.size() - 1);
+  auto lo = static_cast<std::size_t>(rank);
+  auto hi = (lo + 1 < secs.size()) ? lo + 1 : lo;
+  double frac = rank - static_cast<double>(lo);
+  return secs[lo] + (secs[hi] - secs[lo]) * frac;
+}
+
+std::ostream &operator<<(std::ostream &strm, const durations_t &that) {
+  if (that.secs.empty()) {
+    return strm << "no runs";
+  }
+  return strm
+      << "median " << dur_t { that.get_median() }
+      << " (p90 " << dur_t { that.get_percentile(90) }
+      << ", p99 " << dur_t { that.get_percentile(99) }
+      << ", min " << dur_t { that.secs.front() }
+      << ", max " << dur_t { that.secs.back() }
+      << ", " << that.secs.size() << " runs after " << that.warmup_cnt
+      << " warmup)";
+}
+
+// Counts the allocations made with operator new by one thread while it's on.
+// Sizes are as reported by malloc_usable_size(), so that a block counts the
+// same when it's freed as when it was allocated.  Blocks allocated before
+// the meter was turned on may be freed while it's on, so the live counts
+// can go negative.
+class alloc_meter_t final {
+public:
+
+  void on_alloc(void *ptr) noexcept {
+    auto size = static_cast<long long>(malloc_usable_size(ptr));
+    ++cnt;
+    bytes += size;
+    ++live_cnt;
+    live_bytes += size;
+    if (live_bytes > peak_bytes) {
+      peak_bytes = live_bytes;
     }
-    switch (opt) {
-      case 'n': {
-        cfg.regex = std::regex { optarg };
-        break;
+  }
+
+  void on_free(void *ptr) noexcept {
+    --live_cnt;
+    live_bytes -= static_cast<long long>(malloc_usable_size(ptr));
+  }
+
+  allocs_t get_allocs() const noexcept {
+    auto to_size = [](long long val) {
+      return static_cast<std::size_t>((val > 0) ? val : 0);
+    };
+    return allocs_t {
+      to_size(cnt), to_size(bytes), to_size(peak_bytes), to_size(live_cnt),
+      to_size(live_bytes)
+    };
+  }
+
+  bool on;
+
+  long long cnt, bytes, live_cnt, live_bytes, peak_bytes;
+
+};  // alloc_meter_t
+
+// Zero-initialized, so that reaching it from operator new costs no guard.
+static thread_local alloc_meter_t meter;
+
+// Turns the meter off for the lifetime of the pause, so that lick's own
+// bookkeeping doesn't count against the fixture.
+class alloc_pause_t final {
+public:
+
+  alloc_pause_t() noexcept
+      : was_on(meter.on) {
+    meter.on = false;
+  }
+
+  alloc_pause_t(const alloc_pause_t &) = delete;
+
+  ~alloc_pause_t() {
+    meter.on = was_on;
+  }
+
+  alloc_pause_t &operator=(const alloc_pause_t &) = delete;
+
+private:
+
+  bool was_on;
+
+};  // alloc_pause_t
+
+// The perf events of one thread, opened the first time the thread counts
+// anything and left running from then on, so that counting a stretch of code
+// costs only a read of each event at either end.  An event which the system
+// won't count stays closed.
+class perf_t final {
+public:
+
+  perf_t() noexcept
+      : opened(false) {}
+
+  perf_t(const perf_t &) = delete;
+
+  ~perf_t() {
+    close_all();
+  }
+
+  perf_t &operator=(const perf_t &) = delete;
+
+  // Reads the count and the enabled and running times of each event, or -1
+  // for each where the event is closed.
+  void read_all(long long *vals, long long *enabled, long long *running) {
+    if (!opened) {
+      open_all();
+    }
+    for (std::size_t i = 0; i < event_cnt; ++i) {
+      std::uint64_t buf[3];
+      if (fds[i] < 0 || ::read(fds[i], buf, sizeof(buf)) != sizeof(buf)) {
+        vals[i] = enabled[i] = running[i] = -1;
+        continue;
       }
-      case 's': {
-        cfg.strict = true;
-        break;
+      vals[i] = static_cast<long long>(buf[0]);
+      enabled[i] = static_cast<long long>(buf[1]);
+      running[i] = static_cast<long long>(buf[2]);
+    }
+  }
+
+  // Closes the events, so that they'll be opened afresh when next needed.
+  // A forked child must do this, since the events it inherits count the
+  // parent's thread.
+  void close_all() noexcept {
+    if (!opened) {
+      return;
+    }
+    for (int fd : fds) {
+      if (fd >= 0) {
+        close(fd);
       }
-      case 'v': {
-        cfg.set_verbosity(atoi(optarg));
-        break;
+    }
+    opened = false;
+  }
+
+private:
+
+  void open_all() noexcept {
+    static const std::pair<std::uint32_t, std::uint64_t> configs[event_cnt] = {
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+      {
+        PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+      },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+      { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES }
+    };
+    for (std::size_t i = 0; i < event_cnt; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = configs[i].first;
+      attr.config = configs[i].second;
+      attr.read_format =
+          PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      /* Counting only user space is all that an unprivileged process may
+         do under the default perf_event_paranoid setting, but a software
+         event such as a context switch happens only in the kernel, so it's
+         worth trying to include the kernel first. */
+      attr.exclude_kernel = (attr.type != PERF_TYPE_SOFTWARE);
+      attr.exclude_hv = 1;
+      fds[i] = open_event(attr);
+      if (fds[i] < 0 && !attr.exclude_kernel) {
+        attr.exclude_kernel = 1;
+        fds[i] = open_event(attr);
       }
-      default: {
-        ok = false;
+    }
+    opened = true;
+  }
+
+  static int open_event(perf_event_attr &attr) noexcept {
+    return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+  }
+
+  bool opened;
+
+  int fds[event_cnt];
+
+};  // perf_t
+
+static thread_local perf_t perf;
+
+std::ostream &operator<<(std::ostream &strm, event_t event) {
+  static const char *names[event_cnt] = {
+    "cycles", "instructions", "branch-misses", "l1d-misses", "llc-misses",
+    "context-switches"
+  };
+  return strm << names[static_cast<std::size_t>(event)];
+}
+
+std::ostream &operator<<(std::ostream &strm, const counters_t &that) {
+  const char *sep = "";
+  for (std::size_t i = 0; i < event_cnt; ++i) {
+    auto event = static_cast<event_t>(i);
+    if (!that.has(event)) {
+      continue;
+    }
+    strm << sep;
+    if (that.op_cnt > 1) {
+      std::ostringstream val;
+      val << std::setprecision(4) << that.get_per_op(event);
+      strm << val.str() << ' ' << event << "/op";
+    } else {
+      strm << that.get(event) << ' ' << event;
+    }
+    sep = ", ";
+  }
+  if (!*sep) {
+    strm << "no events counted";
+  }
+  return strm;
+}
+
+event_counter_t::event_counter_t(bool starts) {
+  if (starts) {
+    start();
+  }
+}
+
+void event_counter_t::start() {
+  perf.read_all(start_vals, start_enabled, start_running);
+}
+
+counters_t event_counter_t::stop(long long op_cnt) {
+  long long vals[event_cnt], enabled[event_cnt], running[event_cnt];
+  perf.read_all(vals, enabled, running);
+  counters_t counters {};
+  counters.counted = true;
+  counters.op_cnt = op_cnt;
+  for (std::size_t i = 0; i < event_cnt; ++i) {
+    auto &val = counters.vals[i];
+    if (vals[i] < 0 || start_vals[i] < 0) {
+      val = -1;
+      continue;
+    }
+    val = vals[i] - start_vals[i];
+    /* Scale up for the time the event spent off the hardware. */
+    auto enabled_delta = enabled[i] - start_enabled[i],
+         running_delta = running[i] - start_running[i];
+    if (running_delta > 0 && running_delta < enabled_delta) {
+      val = static_cast<long long>(
+          static_cast<double>(val) * static_cast<double>(enabled_delta)
+          / static_cast<double>(running_delta));
+    }
+  }
+  return counters;
+}
+
+// The range kernels.  Each compares values a vector at a time, ORing the
+// lanes which miss into an accumulator, and checks the accumulator once per
+// block of vectors.  Passing ranges are the common case, so a block is
+// counted, one value at a time, only when it has a miss at all.
+
+template <typename elem_t, std::size_t vec_size>
+class vec_of final {
+public:
+
+  typedef elem_t type __attribute__((vector_size(vec_size)));
+
+};  // vec_of<elem_t, vec_size>
+
+template <range_op_t op, typename elem_t>
+static inline std::size_t count_scalar_misses(
+    const char *lhs, const char *rhs, std::size_t start,
+    std::size_t stop) noexcept {
+  std::size_t miss_cnt = 0;
+  for (auto idx = start; idx < stop; ++idx) {
+    /* The caller's values may be of another type of the same size, so
+       they're copied out rather than pointed at. */
+    elem_t lhs_val, rhs_val;
+    std::memcpy(&lhs_val, lhs + idx * sizeof(elem_t), sizeof(elem_t));
+    std::memcpy(&rhs_val, rhs + idx * sizeof(elem_t), sizeof(elem_t));
+    miss_cnt += !test_range_elem<op>(lhs_val, rhs_val);
+  }  // for
+  return miss_cnt;
+}
+
+// Inlined into each of the target-specific kernels below, so that the
+// vector operations compile for that target.
+template <range_op_t op, typename elem_t, std::size_t vec_size>
+__attribute__((always_inline)) static inline std::size_t count_vec_misses(
+    const char *lhs, const char *rhs, std::size_t size) noexcept {
+  using vec_t = typename vec_of<elem_t, vec_size>::type;
+  using mask_t = decltype(vec_t {} == vec_t {});
+  static constexpr std::size_t
+      lane_cnt = vec_size / sizeof(elem_t),
+      block_size = lane_cnt * 16;
+  std::size_t miss_cnt = 0, start = 0;
+  for (; start + block_size <= size; start += block_size) {
+    mask_t misses = {};
+    for (auto idx = start; idx < start + block_size; idx += lane_cnt) {
+      vec_t lhs_vec, rhs_vec;
+      std::memcpy(&lhs_vec, lhs + idx * sizeof(elem_t), vec_size);
+      std::memcpy(&rhs_vec, rhs + idx * sizeof(elem_t), vec_size);
+      switch (op) {
+        case range_op_t::eq: {
+          misses |= ~(lhs_vec == rhs_vec);
+          break;
+        }
+        case range_op_t::lt: {
+          misses |= ~(lhs_vec < rhs_vec);
+          break;
+        }
+        case range_op_t::le: {
+          misses |= ~(lhs_vec <= rhs_vec);
+          break;
+        }
+        case range_op_t::gt: {
+          misses |= ~(lhs_vec > rhs_vec);
+          break;
+        }
+        case range_op_t::ge: {
+          misses |= ~(lhs_vec >= rhs_vec);
+          break;
+        }
       }
+    }  // for
+    std::uint64_t words[vec_size / 8];
+    std::memcpy(words, &misses, vec_size);
+    std::uint64_t any = 0;
+    for (auto word : words) {
+      any |= word;
     }
-  } while (ok);
-  return ok;
+    if (any) {
+      miss_cnt += count_scalar_misses<op, elem_t>(
+          lhs, rhs, start, start + block_size);
+    }
+  }  // for
+  return miss_cnt + count_scalar_misses<op, elem_t>(lhs, rhs, start, size);
 }
 
-ctxt_t::ctxt_t(const fixture_t *fixture_, const cfg_t &cfg_)
-    : fixture(fixture_), cfg(cfg_), showing(false), ok(true) {
-  singleton = this;
-  if (cfg.get_verbosity() >= 2) {
-    on_begin_show();
+// The ULP distance of the range kernels, which is that of get_ulp_distance()
+// but no greater than the largest number of the values' size, so that the
+// vector and scalar code agree.  Only a NaN is that far from anything.
+template <typename elem_t>
+using ulp_bits_t = typename std::conditional<
+    sizeof(elem_t) == 4, std::uint32_t, std::uint64_t>::type;
+
+template <typename elem_t>
+static inline void add_scalar_ulp_stats(
+    const tolerance_t &tol, const char *lhs, const char *rhs,
+    std::size_t start, std::size_t stop, ulp_stats_t &stats) noexcept {
+  for (auto idx = start; idx < stop; ++idx) {
+    elem_t lhs_val, rhs_val;
+    std::memcpy(&lhs_val, lhs + idx * sizeof(elem_t), sizeof(elem_t));
+    std::memcpy(&rhs_val, rhs + idx * sizeof(elem_t), sizeof(elem_t));
+    auto dist = std::min<std::uint64_t>(
+        get_ulp_distance(lhs_val, rhs_val),
+        std::numeric_limits<ulp_bits_t<elem_t>>::max());
+    stats.miss_cnt += !tol.admits(lhs_val, rhs_val);
+    if (dist > stats.max_ulps) {
+      stats.max_ulps = dist;
+      stats.worst_idx = idx;
+    }
+    stats.total_ulps += static_cast<double>(dist);
+  }  // for
+}
+
+// Inlined into each of the target-specific kernels, as count_vec_misses()
+// is.  The distances are found as get_ulp_distance() finds them, but a
+// vector at a time, and the lanes' greatest distances, and where they were,
+// are kept in vectors until the end of each block.
+template <tolerance_t::kind_t kind, typename elem_t, std::size_t vec_size>
+__attribute__((always_inline)) static inline void add_vec_ulp_stats(
+    const tolerance_t &tol, const char *lhs, const char *rhs,
+    std::size_t size, ulp_stats_t &stats) noexcept {
+  using ubits_t = ulp_bits_t<elem_t>;
+  using bits_t = typename std::make_signed<ubits_t>::type;
+  using vec_t = typename vec_of<elem_t, vec_size>::type;
+  using ivec_t = typename vec_of<bits_t, vec_size>::type;
+  using uvec_t = typename vec_of<ubits_t, vec_size>::type;
+  static constexpr std::size_t
+      lane_cnt = vec_size / sizeof(elem_t),
+      block_size = lane_cnt * 16;
+  using dvec_t = typename vec_of<double, lane_cnt * sizeof(double)>::type;
+  static constexpr auto
+      min_bits = std::numeric_limits<bits_t>::min(),
+      max_bits = std::numeric_limits<bits_t>::max();
+  static constexpr auto max_dist = std::numeric_limits<ubits_t>::max();
+  auto val = static_cast<elem_t>(tol.get_val());
+  if (kind == tolerance_t::kind_t::coef) {
+    val *= std::numeric_limits<elem_t>::epsilon();
   }
+  auto abs = static_cast<elem_t>(tol.get_abs());
+  auto max_ulps = static_cast<ubits_t>(
+      std::min(tol.get_val(), static_cast<double>(max_dist)));
+  std::size_t start = 0;
+  for (; start + block_size <= size; start += block_size) {
+    ivec_t miss_cnts = {};
+    uvec_t max_dists = {}, worst_idxs = {}, idxs;
+    dvec_t totals = {};
+    for (std::size_t lane = 0; lane < lane_cnt; ++lane) {
+      idxs[lane] = static_cast<ubits_t>(lane);
+    }
+    for (auto idx = start; idx < start + block_size; idx += lane_cnt) {
+      vec_t lhs_vec, rhs_vec;
+      std::memcpy(&lhs_vec, lhs + idx * sizeof(elem_t), vec_size);
+      std::memcpy(&rhs_vec, rhs + idx * sizeof(elem_t), vec_size);
+      /* A C-style cast between vectors of the same size keeps the bits. */
+      auto lhs_bits = (ivec_t)lhs_vec,
+           rhs_bits = (ivec_t)rhs_vec;
+      lhs_bits = (lhs_bits < 0) ? min_bits - lhs_bits : lhs_bits;
+      rhs_bits = (rhs_bits < 0) ? min_bits - rhs_bits : rhs_bits;
+      auto lhs_ubits = (uvec_t)lhs_bits,
+           rhs_ubits = (uvec_t)rhs_bits;
+      uvec_t dists = (lhs_bits > rhs_bits)
+          ? lhs_ubits - rhs_ubits : rhs_ubits - lhs_ubits;
+      dists = ((lhs_vec != lhs_vec) | (rhs_vec != rhs_vec))
+          ? max_dist : dists;
+      ivec_t oks;
+      if (kind == tolerance_t::kind_t::ulps) {
+        oks = (dists <= max_ulps);
+      } else {
+        vec_t diff = lhs_vec - rhs_vec;
+        auto diff_bits = (ivec_t)diff & max_bits;
+        auto abs_diff = (vec_t)diff_bits;
+        if (kind == tolerance_t::kind_t::coef) {
+          oks = (abs_diff < val);
+        } else if (kind == tolerance_t::kind_t::abs) {
+          oks = (abs_diff <= val);
+        } else {
+          auto lhs_abs = (vec_t)((ivec_t)lhs_vec & max_bits),
+               rhs_abs = (vec_t)((ivec_t)rhs_vec & max_bits);
+          vec_t bound = ((lhs_abs > rhs_abs) ? lhs_abs : rhs_abs) * val;
+          bound = (bound > abs) ? bound : abs;
+          oks = (abs_diff <= bound);
+        }
+      }
+      /* A lane which passes is all ones, so one more makes it zero. */
+      miss_cnts += oks + 1;
+      auto greater = (dists > max_dists);
+      max_dists = greater ? dists : max_dists;
+      worst_idxs = greater ? idxs : worst_idxs;
+      totals += __builtin_convertvector(dists, dvec_t);
+      idxs += static_cast<ubits_t>(lane_cnt);
+    }  // for
+    for (std::size_t lane = 0; lane < lane_cnt; ++lane) {
+      stats.miss_cnt += static_cast<std::size_t>(miss_cnts[lane]);
+      stats.total_ulps += totals[lane];
+      auto dist = static_cast<std::uint64_t>(max_dists[lane]);
+      auto idx = start + worst_idxs[lane];
+      if (dist > stats.max_ulps
+          || (dist == stats.max_ulps && dist && idx < stats.worst_idx)) {
+        stats.max_ulps = dist;
+        stats.worst_idx = idx;
+      }
+    }  // for
+  }  // for
+  add_scalar_ulp_stats<elem_t>(tol, lhs, rhs, start, size, stats);
 }
 
-ctxt_t::~ctxt_t() {
-  on_end_show();
-  singleton = nullptr;
+// The kernels for each instruction set, which count_range_misses() and
+// compare_almost_eq() choose among.
+class scalar_kernels_t final {
+public:
+
+  template <range_op_t op, typename elem_t>
+  static std::size_t run(
+      const char *lhs, const char *rhs, std::size_t size) noexcept {
+    return count_scalar_misses<op, elem_t>(lhs, rhs, 0, size);
+  }
+
+  template <tolerance_t::kind_t kind, typename elem_t>
+  static void add_ulp_stats(
+      const tolerance_t &tol, const char *lhs, const char *rhs,
+      std::size_t size, ulp_stats_t &stats) noexcept {
+    add_scalar_ulp_stats<elem_t>(tol, lhs, rhs, 0, size, stats);
+  }
+
+};  // scalar_kernels_t
+
+#if defined(__x86_64__)
+
+/* SSE2 is part of x86-64, so it needs no target of its own. */
+class sse2_kernels_t final {
+public:
+
+  template <range_op_t op, typename elem_t>
+  static std::size_t run(
+      const char *lhs, const char *rhs, std::size_t size) noexcept {
+    return count_vec_misses<op, elem_t, 16>(lhs, rhs, size);
+  }
+
+  template <tolerance_t::kind_t kind, typename elem_t>
+  static void add_ulp_stats(
+      const tolerance_t &tol, const char *lhs, const char *rhs,
+      std::size_t size, ulp_stats_t &stats) noexcept {
+    add_vec_ulp_stats<kind, elem_t, 16>(tol, lhs, rhs, size, stats);
+  }
+
+};  // sse2_kernels_t
+
+class avx2_kernels_t final {
+public:
+
+  template <range_op_t op, typename elem_t>
+  __attribute__((target("avx2"))) static std::size_t run(
+      const char *lhs, const char *rhs, std::size_t size) noexcept {
+    return count_vec_misses<op, elem_t, 32>(lhs, rhs, size);
+  }
+
+  template <tolerance_t::kind_t kind, typename elem_t>
+  __attribute__((target("avx2"))) static void add_ulp_stats(
+      const tolerance_t &tol, const char *lhs, const char *rhs,
+      std::size_t size, ulp_stats_t &stats) noexcept {
+    add_vec_ulp_stats<kind, elem_t, 32>(tol, lhs, rhs, size, stats);
+  }
+
+};  // avx2_kernels_t
+
+#endif
+
+template <typename kernels_t, typename elem_t>
+static std::size_t count_range_misses(
+    range_op_t op, const char *lhs, const char *rhs,
+    std::size_t size) noexcept {
+  switch (op) {
+    case range_op_t::eq: {
+      return kernels_t::template run<range_op_t::eq, elem_t>(lhs, rhs, size);
+    }
+    case range_op_t::lt: {
+      return kernels_t::template run<range_op_t::lt, elem_t>(lhs, rhs, size);
+    }
+    case range_op_t::le: {
+      return kernels_t::template run<range_op_t::le, elem_t>(lhs, rhs, size);
+    }
+    case range_op_t::gt: {
+      return kernels_t::template run<range_op_t::gt, elem_t>(lhs, rhs, size);
+    }
+    case range_op_t::ge: {
+      return kernels_t::template run<range_op_t::ge, elem_t>(lhs, rhs, size);
+    }
+  }
+  return 0;
 }
 
-void ctxt_t::on_begin_show() const {
-  if (showing) {
-    return;
+template <typename kernels_t>
+static std::size_t count_range_misses(
+    range_op_t op, elem_kind_t kind, const char *lhs, const char *rhs,
+    std::size_t size) noexcept {
+  switch (kind) {
+    case elem_kind_t::s8: {
+      return count_range_misses<kernels_t, std::int8_t>(op, lhs, rhs, size);
+    }
+    case elem_kind_t::u8: {
+      return count_range_misses<kernels_t, std::uint8_t>(op, lhs, rhs, size);
+    }
+    case elem_kind_t::s16: {
+      return count_range_misses<kernels_t, std::int16_t>(op, lhs, rhs, size);
+    }
+    case elem_kind_t::u16: {
+      return count_range_misses<kernels_t, std::uint16_t>(
+          op, lhs, rhs, size);
+    }
+    case elem_kind_t::s32: {
+      return count_range_misses<kernels_t, std::int32_t>(op, lhs, rhs, size);
+    }
+    case elem_kind_t::u32: {
+      return count_range_misses<kernels_t, std::uint32_t>(
+          op, lhs, rhs, size);
+    }
+    case elem_kind_t::s64: {
+      return count_range_misses<kernels_t, std::int64_t>(op, lhs, rhs, size);
+    }
+    case elem_kind_t::u64: {
+      return count_range_misses<kernels_t, std::uint64_t>(
+          op, lhs, rhs, size);
+    }
+    case elem_kind_t::f32: {
+      return count_range_misses<kernels_t, float>(op, lhs, rhs, size);
+    }
+    case elem_kind_t::f64: {
+      return count_range_misses<kernels_t, double>(op, lhs, rhs, size);
+    }
+    case elem_kind_t::none: {
+      break;
+    }
   }
-  showing = true;
-  cfg.get_strm()
-      << fixture->get_loc() << separator
-      << "begin " << bold << fixture->get_name() << plain
-      << std::endl;
+  return 0;
 }
 
-void ctxt_t::on_end_show() const {
-  if (!showing) {
-    return;
+std::size_t count_range_misses(
+    range_op_t op, elem_kind_t kind, const void *lhs, const void *rhs,
+    std::size_t size) noexcept {
+  auto lhs_bytes = static_cast<const char *>(lhs),
+       rhs_bytes = static_cast<const char *>(rhs);
+#if defined(__x86_64__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2
+      ? count_range_misses<avx2_kernels_t>(
+          op, kind, lhs_bytes, rhs_bytes, size)
+      : count_range_misses<sse2_kernels_t>(
+          op, kind, lhs_bytes, rhs_bytes, size);
+#else
+  return count_range_misses<scalar_kernels_t>(
+      op, kind, lhs_bytes, rhs_bytes, size);
+#endif
+}
+
+template <typename kernels_t, typename elem_t>
+static ulp_stats_t compare_almost_eq(
+    const tolerance_t &tol, const char *lhs, const char *rhs,
+    std::size_t size) noexcept {
+  using kind_t = tolerance_t::kind_t;
+  ulp_stats_t stats { 0, 0, 0, 0 };
+  switch (tol.get_kind()) {
+    case kind_t::coef: {
+      kernels_t::template add_ulp_stats<kind_t::coef, elem_t>(
+          tol, lhs, rhs, size, stats);
+      break;
+    }
+    case kind_t::ulps: {
+      kernels_t::template add_ulp_stats<kind_t::ulps, elem_t>(
+          tol, lhs, rhs, size, stats);
+      break;
+    }
+    case kind_t::rel: {
+      kernels_t::template add_ulp_stats<kind_t::rel, elem_t>(
+          tol, lhs, rhs, size, stats);
+      break;
+    }
+    case kind_t::abs: {
+      kernels_t::template add_ulp_stats<kind_t::abs, elem_t>(
+          tol, lhs, rhs, size, stats);
+      break;
+    }
+  }
+  if (stats.max_ulps == std::numeric_limits<ulp_bits_t<elem_t>>::max()) {
+    stats.max_ulps = std::numeric_limits<std::uint64_t>::max();
+  }
+  return stats;
+}
+
+template <typename kernels_t>
+static ulp_stats_t compare_almost_eq(
+    elem_kind_t kind, const tolerance_t &tol, const char *lhs,
+    const char *rhs, std::size_t size) noexcept {
+  return (kind == elem_kind_t::f32)
+      ? compare_almost_eq<kernels_t, float>(tol, lhs, rhs, size)
+      : compare_almost_eq<kernels_t, double>(tol, lhs, rhs, size);
+}
+
+ulp_stats_t compare_almost_eq(
+    elem_kind_t kind, const tolerance_t &tol, const void *lhs,
+    const void *rhs, std::size_t size) noexcept {
+  auto lhs_bytes = static_cast<const char *>(lhs),
+       rhs_bytes = static_cast<const char *>(rhs);
+#if defined(__x86_64__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2
+      ? compare_almost_eq<avx2_kernels_t>(
+          kind, tol, lhs_bytes, rhs_bytes, size)
+      : compare_almost_eq<sse2_kernels_t>(
+          kind, tol, lhs_bytes, rhs_bytes, size);
+#else
+  return compare_almost_eq<scalar_kernels_t>(
+      kind, tol, lhs_bytes, rhs_bytes, size);
+#endif
+}
+
+// Writes a distance in ULPs, or "NaN" for the distance of a NaN.
+static void write_ulps(std::ostream &strm, std::uint64_t ulps) {
+  if (ulps == std::numeric_limits<std::uint64_t>::max()) {
+    strm << "NaN";
+  } else {
+    strm << ulps;
   }
-  cfg.get_strm()
-      << "end " << bold << fixture->get_name() << plain << separator
-      << pf_t { ok } << std::endl;
 }
 
-thread_local ctxt_t *ctxt_t::singleton = nullptr;
+template <typename elem_t>
+static std::string describe_almost_eq(
+    const tolerance_t &tol, const elem_t *lhs, std::size_t lhs_size,
+    const elem_t *rhs, std::size_t rhs_size) {
+  std::ostringstream strm;
+  strm.precision(std::numeric_limits<elem_t>::max_digits10);
+  if (lhs_size != rhs_size) {
+    strm
+        << separator << "sizes differ, " << lhs_size << " vs " << rhs_size;
+  }
+  auto size = std::min(lhs_size, rhs_size);
+  if (!size) {
+    return strm.str();
+  }
+  auto stats = compare_almost_eq(
+      get_elem_kind<elem_t>(), tol, lhs, rhs, size);
+  if (stats.miss_cnt) {
+    strm << separator << stats.miss_cnt << " of " << size << " values missed";
+  }
+  strm << separator << "max ";
+  write_ulps(strm, stats.max_ulps);
+  strm
+      << " ulps at [" << stats.worst_idx << "] "
+      << lhs[stats.worst_idx] << " vs " << rhs[stats.worst_idx]
+      << std::setprecision(4);
+  if (!stats.miss_cnt) {
+    strm
+        << separator << "mean "
+        << (stats.total_ulps / static_cast<double>(size)) << " ulps";
+    return strm.str();
+  }
+  /* The histogram is wanted only when something is wrong, so it's worked
+     out here, a pair at a time, along with a mean that leaves out the NaNs.
+     Bucket 0 holds the distances of 0, bucket n those from 2^(n - 1) to
+     2^n - 1, and the last bucket the NaNs. */
+  std::size_t buckets[66] = {};
+  double total_ulps = 0;
+  for (std::size_t idx = 0; idx < size; ++idx) {
+    auto dist = get_ulp_distance(lhs[idx], rhs[idx]);
+    if (dist == std::numeric_limits<std::uint64_t>::max()) {
+      ++buckets[65];
+      continue;
+    }
+    ++buckets[dist ? 64 - __builtin_clzll(dist) : 0];
+    total_ulps += static_cast<double>(dist);
+  }  // for
+  auto cnt = size - buckets[65];
+  strm
+      << separator << "mean "
+      << (cnt ? total_ulps / static_cast<double>(cnt) : 0.0) << " ulps";
+  strm << separator << "histogram ";
+  const char *sep = "";
+  for (int bucket = 0; bucket < 66; ++bucket) {
+    if (!buckets[bucket]) {
+      continue;
+    }
+    strm << sep;
+    if (bucket == 65) {
+      strm << "NaN";
+    } else if (bucket <= 1) {
+      strm << bucket;
+    } else if (bucket == 64) {
+      strm << (1ull << 63) << '+';
+    } else {
+      strm << (1ull << (bucket - 1)) << '-' << ((1ull << bucket) - 1);
+    }
+    strm << ": " << buckets[bucket];
+    sep = ", ";
+  }  // for
+  return strm.str();
+}
+
+std::string describe_almost_eq(
+    elem_kind_t kind, const tolerance_t &tol, const void *lhs,
+    std::size_t lhs_size, const void *rhs, std::size_t rhs_size) {
+  return (kind == elem_kind_t::f32)
+      ? describe_almost_eq(
+          tol, static_cast<const float *>(lhs), lhs_size,
+          static_cast<const float *>(rhs), rhs_size)
+      : describe_almost_eq(
+          tol, static_cast<const double *>(lhs), lhs_size,
+          static_cast<const double *>(rhs), rhs_size);
+}
+
+std::ostream &operator<<(std::ostream &strm, const tolerance_t &that) {
+  switch (that.kind) {
+    case tolerance_t::kind_t::coef: {
+      strm << that.val << " epsilon";
+      break;
+    }
+    case tolerance_t::kind_t::ulps: {
+      strm << that.val << " ulps";
+      break;
+    }
+    case tolerance_t::kind_t::rel: {
+      strm << "rel " << that.val;
+      if (that.abs > 0) {
+        strm << ", abs " << that.abs;
+      }
+      break;
+    }
+    case tolerance_t::kind_t::abs: {
+      strm << "abs " << that.val;
+      break;
+    }
+  }
+  return strm;
+}
+
+std::string get_ex_msg(const std::exception &ex) {
+  std::ostringstream strm;
+  write_ex(strm, ex);
+  return strm.str();
+}
+
+const std::string &get_ex_msg() {
+  static const std::string ex_msg = "non-standard exception";
+  return ex_msg;
+}
+
+reporter_t::~reporter_t() = default;
+
+void replace_file(
+    const std::string &path, const std::function<void (std::ostream &)> &fn) {
+  auto temp_path = path + ".tmp";
+  {
+    std::ofstream strm { temp_path };
+    fn(strm);
+    if (!strm.flush()) {
+      throw std::system_error {
+        errno, std::system_category(), "write " + temp_path
+      };
+    }
+  }
+  if (std::rename(temp_path.c_str(), path.c_str()) < 0) {
+    throw std::system_error {
+      errno, std::system_category(), "rename " + temp_path
+    };
+  }
+}
+
+// The samples of benchmarks as they ran at some earlier time, by name.  The
+// file holds one line per benchmark, giving its name, its sample count, and
+// then its samples.
+class baseline_t final {
+public:
+
+  baseline_t() = default;
+
+  baseline_t(const baseline_t &) = delete;
+
+  baseline_t &operator=(const baseline_t &) = delete;
+
+  // The benchmark's samples, or null if it has none.
+  const std::vector<double> *find(const std::string &name) const {
+    auto iter = samples.find(name);
+    return (iter != samples.end()) ? &iter->second : nullptr;
+  }
+
+  void set(const std::string &name, std::vector<double> samples_) {
+    samples[name] = std::move(samples_);
+  }
+
+  // Returns false if there's no file at the path.  Throws if the file isn't
+  // a baseline.
+  bool load(const std::string &path) {
+    /* More samples than any benchmark takes, so that a corrupt count can't
+       ask for an absurd allocation. */
+    static const std::size_t max_cnt = 1 << 20;
+    std::ifstream strm { path };
+    if (!strm) {
+      return false;
+    }
+    auto malformed = [&] {
+      return std::runtime_error { "malformed baseline file " + path };
+    };
+    std::string name;
+    while (strm >> name) {
+      std::size_t cnt;
+      if (!(strm >> cnt) || cnt > max_cnt) {
+        throw malformed();
+      }
+      std::vector<double> vals(cnt);
+      for (auto &val : vals) {
+        if (!(strm >> val)) {
+          throw malformed();
+        }
+      }  // for
+      samples[name] = std::move(vals);
+    }  // while
+    if (!strm.eof()) {
+      throw malformed();
+    }
+    return true;
+  }
+
+  void save(const std::string &path) const {
+    replace_file(
+        path,
+        [this](std::ostream &strm) {
+          strm << std::setprecision(9);
+          for (const auto &pair : samples) {
+            strm << pair.first << ' ' << pair.second.size();
+            for (double val : pair.second) {
+              strm << ' ' << val;
+            }
+            strm << '\n';
+          }
+        }
+    );
+  }
+
+private:
+
+  std::map<std::string, std::vector<double>> samples;
+
+};  // baseline_t
+
+// The p-value of a one-sided Mann-Whitney U test that the values in 'now'
+// tend to be greater than those in 'then'.  With no assumption about the
+// shape of the distributions, this suits timings, whose tails are long.  It
+// uses the normal approximation, with corrections for ties and continuity.
+static double get_greater_p(
+    const std::vector<double> &then, const std::vector<double> &now) {
+  auto then_cnt = static_cast<double>(then.size()),
+       now_cnt = static_cast<double>(now.size());
+  std::vector<std::pair<double, bool>> vals;
+  for (double val : then) {
+    vals.emplace_back(val, false);
+  }
+  for (double val : now) {
+    vals.emplace_back(val, true);
+  }
+  std::sort(vals.begin(), vals.end());
+  double now_rank_sum = 0, tie_sum = 0;
+  for (std::size_t lo = 0; lo < vals.size();) {
+    auto hi = lo;
+    while (hi < vals.size() && vals[hi].first == vals[lo].first) {
+      ++hi;
+    }
+    /* Tied values share the mean of their ranks, which count from 1. */
+    double rank = static_cast<double>(lo + hi + 1) / 2;
+    auto tie_cnt = static_cast<double>(hi - lo);
+    tie_sum += tie_cnt * tie_cnt * tie_cnt - tie_cnt;
+    for (; lo < hi; ++lo) {
+      if (vals[lo].second) {
+        now_rank_sum += rank;
+      }
+    }
+  }
+  double all_cnt = then_cnt + now_cnt;
+  double u = now_rank_sum - now_cnt * (now_cnt + 1) / 2;
+  double mean = then_cnt * now_cnt / 2;
+  double var = then_cnt * now_cnt / 12
+      * ((all_cnt + 1) - tie_sum / (all_cnt * (all_cnt - 1)));
+  if (var <= 0) {
+    return 1;
+  }
+  double z = (u - mean - 0.5) / std::sqrt(var);
+  return std::erfc(z / std::sqrt(2.0)) / 2;
+}
+
+static double get_median(std::vector<double> vals) {
+  std::sort(vals.begin(), vals.end());
+  auto size = vals.size();
+  return size ? (vals[(size - 1) / 2] + vals[size / 2]) / 2 : 0;
+}
+
+// Writes a string as the content of an XML attribute or element.
+static void write_xml(std::ostream &strm, const std::string &str) {
+  for (char c : str) {
+    switch (c) {
+      case '&': {
+        strm << "&amp;";
+        break;
+      }
+      case '<': {
+        strm << "&lt;";
+        break;
+      }
+      case '>': {
+        strm << "&gt;";
+        break;
+      }
+      case '"': {
+        strm << "&quot;";
+        break;
+      }
+      case '\n': {
+        strm << "&#10;";
+        break;
+      }
+      default: {
+        /* XML 1.0 has no way at all to spell most control characters. */
+        if (static_cast<unsigned char>(c) >= 0x20 || c == '\t') {
+          strm << c;
+        }
+      }
+    }
+  }
+}
+
+// Writes a string as a quoted JSON string.
+static void write_json(std::ostream &strm, const std::string &str) {
+  strm << '"';
+  for (char c : str) {
+    switch (c) {
+      case '"': {
+        strm << "\\\"";
+        break;
+      }
+      case '\\': {
+        strm << "\\\\";
+        break;
+      }
+      case '\n': {
+        strm << "\\n";
+        break;
+      }
+      case '\t': {
+        strm << "\\t";
+        break;
+      }
+      default: {
+        if (static_cast<unsigned char>(c) < 0x20) {
+          strm
+              << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+              << static_cast<int>(c) << std::dec << std::setfill(' ');
+        } else {
+          strm << c;
+        }
+      }
+    }
+  }
+  strm << '"';
+}
+
+junit_reporter_t::junit_reporter_t(std::shared_ptr<std::ostream> strm_)
+    : strm(std::move(strm_)) {}
+
+void junit_reporter_t::on_begin_run() {
+  *strm
+      << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      << "<testsuites>\n"
+      << "  <testsuite name=\"lick\">\n" << std::flush;
+}
+
+void junit_reporter_t::on_fixture(
+    const fixture_t &fixture, const outcome_t &outcome) {
+  const auto &loc = fixture.get_loc();
+  *strm << "    <testcase name=\"";
+  write_xml(*strm, fixture.get_name());
+  *strm << "\" classname=\"";
+  write_xml(*strm, loc.get_file());
+  *strm << "\" file=\"";
+  write_xml(*strm, loc.get_file());
+  *strm
+      << "\" line=\"" << loc.get_line()
+      << "\" time=\"" << std::fixed << std::setprecision(6) << outcome.wall
+      << std::defaultfloat << "\"";
+  bool has_failure = false;
+  for (const auto &note : outcome.notes) {
+    if (note.ok) {
+      continue;
+    }
+    if (!has_failure) {
+      *strm << ">\n";
+      has_failure = true;
+    }
+    *strm << "      <failure type=\"" << note.kind << "\" message=\"";
+    write_xml(*strm, note.msg);
+    *strm << "\">";
+    write_xml(*strm, note.loc.get_file());
+    *strm << ':' << note.loc.get_line() << ": ";
+    write_xml(*strm, note.msg);
+    *strm << "</failure>\n";
+  }
+  if (!has_failure && !outcome.ok) {
+    /* A fixture can fail without saying why, as when it calls fail(). */
+    *strm << ">\n      <failure type=\"fail\"/>\n";
+    has_failure = true;
+  }
+  *strm << (has_failure ? "    </testcase>\n" : "/>\n") << std::flush;
+}
+
+void junit_reporter_t::on_end_run(const summary_t &) {
+  *strm
+      << "  </testsuite>\n"
+      << "</testsuites>" << std::endl;
+}
+
+json_reporter_t::json_reporter_t(std::shared_ptr<std::ostream> strm_)
+    : strm(std::move(strm_)) {}
+
+void json_reporter_t::on_begin_run() {
+  *strm << "{\"type\":\"begin\"}" << std::endl;
+}
+
+void json_reporter_t::on_fixture(
+    const fixture_t &fixture, const outcome_t &outcome) {
+  const auto &loc = fixture.get_loc();
+  *strm << "{\"type\":\"fixture\",\"name\":";
+  write_json(*strm, fixture.get_name());
+  *strm << ",\"file\":";
+  write_json(*strm, loc.get_file());
+  *strm
+      << ",\"line\":" << loc.get_line()
+      << ",\"ok\":" << (outcome.ok ? "true" : "false")
+      << ",\"wall\":" << outcome.wall
+      << ",\"cpu\":" << outcome.cpu;
+  const auto &counters = outcome.counters;
+  if (counters.counted) {
+    *strm << ",\"counters\":{\"ops\":" << counters.op_cnt;
+    for (std::size_t i = 0; i < event_cnt; ++i) {
+      auto event = static_cast<event_t>(i);
+      if (counters.has(event)) {
+        *strm << ",\"" << event << "\":" << counters.get(event);
+      }
+    }
+    *strm << '}';
+  }
+  *strm << ",\"notes\":[";
+  const char *sep = "";
+  for (const auto &note : outcome.notes) {
+    *strm << sep << "{\"kind\":\"" << note.kind << "\",\"file\":";
+    write_json(*strm, note.loc.get_file());
+    *strm
+        << ",\"line\":" << note.loc.get_line()
+        << ",\"ok\":" << (note.ok ? "true" : "false")
+        << ",\"message\":";
+    write_json(*strm, note.msg);
+    *strm << '}';
+    sep = ",";
+  }
+  *strm << "]}" << std::endl;
+}
+
+void json_reporter_t::on_end_run(const summary_t &summary) {
+  *strm
+      << "{\"type\":\"end\""
+      << ",\"passed\":" << summary.pass_cnt
+      << ",\"failed\":" << summary.fail_cnt
+      << ",\"skipped\":" << summary.skip_cnt
+      << ",\"cached\":" << summary.cache_cnt
+      << ",\"ok\":" << (summary.ok ? "true" : "false")
+      << ",\"elapsed\":" << summary.elapsed << '}' << std::endl;
+}
+
+// Calls the function with each word in the string, where words are separated
+// by spaces or commas.
+template <typename fn_t>
+static void for_each_word(const char *str, const fn_t &fn) {
+  static const char *seps = " \t\n,";
+  for (;;) {
+    str += std::strspn(str, seps);
+    auto size = std::strcspn(str, seps);
+    if (!size) {
+      break;
+    }
+    fn(std::string { str, size });
+    str += size;
+  }
+}
+
+// Whether the name matches the glob, in which '*' matches any run of
+// characters and '?' any one character.
+static bool matches_glob(const char *glob, const char *name) {
+  /* On a mismatch, let the most recent star swallow one more character and
+     try again from there.  Earlier stars never need to be revisited. */
+  const char *star = nullptr, *resume = nullptr;
+  while (*name) {
+    if (*glob == '*') {
+      star = ++glob;
+      resume = name;
+    } else if (*glob == '?' || *glob == *name) {
+      ++glob;
+      ++name;
+    } else if (star) {
+      glob = star;
+      name = ++resume;
+    } else {
+      return false;
+    }
+  }
+  while (*glob == '*') {
+    ++glob;
+  }
+  return !*glob;
+}
+
+selector_t::terms_t::terms_t()
+    : nodes(1) {}
+
+bool selector_t::terms_t::is_empty() const noexcept {
+  return names.empty() && globs.empty() && tag_bits.empty();
+}
+
+void selector_t::terms_t::add_glob(const std::string &glob) {
+  auto wild = glob.find_first_of("*?");
+  if (wild == std::string::npos) {
+    names.insert(glob);
+    return;
+  }
+  std::size_t node_idx = 0;
+  for (std::size_t i = 0; i < wild; ++i) {
+    auto &kids = nodes[node_idx].kids;
+    auto iter = std::find_if(
+        kids.begin(), kids.end(),
+        [&](const std::pair<char, std::size_t> &kid) {
+          return kid.first == glob[i];
+        }
+    );
+    if (iter != kids.end()) {
+      node_idx = iter->second;
+    } else {
+      kids.emplace_back(glob[i], nodes.size());
+      node_idx = nodes.size();
+      nodes.emplace_back();
+    }
+  }
+  nodes[node_idx].globs.push_back(globs.size());
+  globs.push_back(glob.substr(wild));
+}
+
+void selector_t::terms_t::add_tag(std::size_t tag_idx) {
+  auto word = tag_idx / 64;
+  if (word >= tag_bits.size()) {
+    tag_bits.resize(word + 1, 0);
+  }
+  tag_bits[word] |= std::uint64_t { 1 } << (tag_idx % 64);
+}
+
+bool selector_t::terms_t::matches_name(const char *name) const {
+  if (!names.empty() && names.count(name)) {
+    return true;
+  }
+  if (globs.empty()) {
+    return false;
+  }
+  std::size_t node_idx = 0;
+  for (const char *rest = name;; ++rest) {
+    const auto &node = nodes[node_idx];
+    for (auto glob_idx : node.globs) {
+      if (matches_glob(globs[glob_idx].c_str(), rest)) {
+        return true;
+      }
+    }
+    if (!*rest) {
+      return false;
+    }
+    auto iter = std::find_if(
+        node.kids.begin(), node.kids.end(),
+        [&](const std::pair<char, std::size_t> &kid) {
+          return kid.first == *rest;
+        }
+    );
+    if (iter == node.kids.end()) {
+      return false;
+    }
+    node_idx = iter->second;
+  }
+}
+
+selector_t::selector_t() = default;
+
+selector_t::selector_t(const std::string &spec) {
+  for_each_word(
+    spec.c_str(),
+    [&](const std::string &word) {
+      bool excludes_ = (word[0] == '!');
+      auto &terms = excludes_ ? excludes : includes;
+      auto term = word.substr(excludes_ ? 1 : 0);
+      if (!term.empty() && term[0] == '@') {
+        auto tag = term.substr(1);
+        if (tag.empty()) {
+          throw std::invalid_argument { "empty tag in \"" + spec + '"' };
+        }
+        terms.add_tag(
+            tag_idxs.emplace(tag, tag_idxs.size()).first->second);
+      } else if (!term.empty()) {
+        terms.add_glob(term);
+      } else {
+        throw std::invalid_argument { "empty term in \"" + spec + '"' };
+      }
+    }
+  );
+}
+
+bool selector_t::has_tag(
+    const fixture_t &fixture, const terms_t &terms) const {
+  if (terms.tag_bits.empty()) {
+    return false;
+  }
+  bool has = false;
+  for_each_word(
+    fixture.get_tags(),
+    [&](const std::string &tag) {
+      auto iter = tag_idxs.find(tag);
+      if (iter != tag_idxs.end() && terms.has_tag(iter->second)) {
+        has = true;
+      }
+    }
+  );
+  return has;
+}
+
+bool selector_t::matches(const fixture_t &fixture) const {
+  auto matches_terms = [&](const terms_t &terms) {
+    return terms.matches_name(fixture.get_name()) || has_tag(fixture, terms);
+  };
+  return (includes.is_empty() || matches_terms(includes))
+      && (excludes.is_empty() || !matches_terms(excludes));
+}
+
+cfg_t::cfg_t()
+    : strm(&std::cout), verbosity(1), jobs(1), fork_batch(0),
+      slow_cnt(0), case_cnt(1000), shard_idx(0), shard_cnt(1),
+      seed(
+          (static_cast<std::uint64_t>(std::random_device {}()) << 32)
+          ^ std::random_device {}()),
+      bench_time(0.5),
+      regression_threshold(0.05), timeout(0),
+      strict(false), forced(false), allocs(false), leaks(false),
+      events(false), tests(true), benches(false), keeps(false) {}
+
+// Codes for the options which have only a long form.
+enum : int {
+  opt_timeout = 256,
+  opt_junit,
+  opt_json,
+  opt_shard,
+  opt_history,
+  opt_cache,
+  opt_force,
+  opt_allocs,
+  opt_leaks,
+  opt_baseline,
+  opt_save_baseline,
+  opt_threshold,
+  opt_counters,
+  opt_cases,
+  opt_seed
+};
+
+static const option long_opts[] = {
+  { "timeout", required_argument, nullptr, opt_timeout },
+  { "junit", required_argument, nullptr, opt_junit },
+  { "json", required_argument, nullptr, opt_json },
+  { "shard", required_argument, nullptr, opt_shard },
+  { "history", required_argument, nullptr, opt_history },
+  { "cache", required_argument, nullptr, opt_cache },
+  { "force", no_argument, nullptr, opt_force },
+  { "allocs", no_argument, nullptr, opt_allocs },
+  { "leaks", no_argument, nullptr, opt_leaks },
+  { "baseline", required_argument, nullptr, opt_baseline },
+  { "save-baseline", required_argument, nullptr, opt_save_baseline },
+  { "threshold", required_argument, nullptr, opt_threshold },
+  { "counters", no_argument, nullptr, opt_counters },
+  { "cases", required_argument, nullptr, opt_cases },
+  { "seed", required_argument, nullptr, opt_seed },
+  { nullptr, 0, nullptr, 0 }
+};
+
+// Opens a file for a reporter to write to.
+static std::shared_ptr<std::ostream> open_report_file(const char *path) {
+  auto strm = std::make_shared<std::ofstream>(path);
+  if (!*strm) {
+    throw std::system_error {
+      errno, std::system_category(), std::string { "open " } + path
+    };
+  }
+  return strm;
+}
+
+bool cfg_t::parse(cfg_t &cfg, int argc, char *argv[]) {
+  bool ok = true;
+  do {
+    int opt = getopt_long(argc, argv, "b:f:j:m:n:st:v:", long_opts, nullptr);
+    if (opt < 0) {
+      break;
+    }
+    switch (opt) {
+      case 'b': {
+        cfg.set_bench_time(atof(optarg));
+        break;
+      }
+      case 'f': {
+        cfg.set_fork_batch(atoi(optarg));
+        break;
+      }
+      case 'j': {
+        int jobs = atoi(optarg);
+        cfg.set_jobs(
+            jobs ? jobs : static_cast<int>(std::thread::hardware_concurrency()));
+        break;
+      }
+      case 'm': {
+        std::string kinds = optarg;
+        if (kinds == "test") {
+          cfg.set_kinds(true, false);
+        } else if (kinds == "bench") {
+          cfg.set_kinds(false, true);
+        } else if (kinds == "all") {
+          cfg.set_kinds(true, true);
+        } else {
+          ok = false;
+        }
+        break;
+      }
+      case 'n': {
+        cfg.set_selector(selector_t { optarg });
+        break;
+      }
+      case 's': {
+        cfg.strict = true;
+        break;
+      }
+      case 't': {
+        cfg.set_slow_cnt(atoi(optarg));
+        break;
+      }
+      case 'v': {
+        cfg.set_verbosity(atoi(optarg));
+        break;
+      }
+      case opt_timeout: {
+        cfg.set_timeout(atof(optarg));
+        break;
+      }
+      case opt_junit: {
+        cfg.add_reporter(
+            std::make_shared<junit_reporter_t>(open_report_file(optarg)));
+        break;
+      }
+      case opt_json: {
+        cfg.add_reporter(
+            std::make_shared<json_reporter_t>(open_report_file(optarg)));
+        break;
+      }
+      case opt_shard: {
+        /* Shards are numbered from 1 on the command line. */
+        int shard_num, shard_cnt;
+        char extra;
+        ok = std::sscanf(
+                optarg, "%d/%d%c", &shard_num, &shard_cnt, &extra) == 2
+            && cfg.set_shard(shard_num - 1, shard_cnt);
+        break;
+      }
+      case opt_history: {
+        cfg.set_history_path(optarg);
+        break;
+      }
+      case opt_cache: {
+        cfg.set_cache_path(optarg);
+        break;
+      }
+      case opt_force: {
+        cfg.set_forced(true);
+        break;
+      }
+      case opt_allocs: {
+        cfg.set_allocs(true);
+        break;
+      }
+      case opt_leaks: {
+        cfg.set_leaks(true);
+        break;
+      }
+      case opt_baseline: {
+        auto baseline = std::make_shared<baseline_t>();
+        if (!baseline->load(optarg)) {
+          throw std::system_error {
+            errno, std::system_category(), std::string { "open " } + optarg
+          };
+        }
+        cfg.set_baseline(std::move(baseline));
+        break;
+      }
+      case opt_save_baseline: {
+        cfg.set_save_baseline_path(optarg);
+        break;
+      }
+      case opt_threshold: {
+        cfg.set_regression_threshold(atof(optarg) / 100);
+        break;
+      }
+      case opt_counters: {
+        cfg.set_events(true);
+        break;
+      }
+      case opt_cases: {
+        cfg.set_case_cnt(atoi(optarg));
+        break;
+      }
+      case opt_seed: {
+        cfg.set_seed(strtoull(optarg, nullptr, 0));
+        break;
+      }
+      default: {
+        ok = false;
+      }
+    }
+  } while (ok);
+  return ok;
+}
+
+ctxt_t::ctxt_t(
+    const fixture_t *fixture_, const cfg_t &cfg_, std::ostream &strm_)
+    : fixture(fixture_), cfg(cfg_), strm(strm_), showing(false),
+      stopped(false), start_wall(get_wall_time()), start_cpu(get_cpu_time()),
+      outcome { true, 0, 0, {}, {}, {}, {} }, counter(false), shared(false),
+      quiet(!fixture || cfg.get_verbosity() < 2) {
+  singleton = this;
+  if (!quiet) {
+    shows_passes.store(true, std::memory_order_relaxed);
+  }
+  if (cfg.get_verbosity() >= 2) {
+    on_begin_show();
+  }
+  /* Coroutine fixtures take turns on one thread, so neither the thread's
+     events nor its allocations are any one fixture's. */
+  if (cfg.counts_events() && fixture && !fixture->is_bench()
+      && !fixture->get_async()) {
+    counter.start();
+  }
+  if (cfg.tracks_allocs() && fixture && !fixture->get_async()) {
+    meter = alloc_meter_t {};
+    meter.on = true;
+  }
+}
+
+ctxt_t::~ctxt_t() {
+  stop();
+  on_end_show();
+  singleton = nullptr;
+}
+
+static void write_begin(std::ostream &strm, const fixture_t &fixture) {
+  strm
+      << fixture.get_loc() << separator
+      << "begin " << bold << fixture.get_name() << plain
+      << '\n';
+}
+
+// Writes the line which ends a fixture's report.  The times are included
+// only when passes are shown, and the allocations only when they're tracked.
+static void write_end(
+    std::ostream &strm, const fixture_t &fixture, const outcome_t &outcome,
+    bool shows_times, bool shows_allocs) {
+  strm
+      << "end " << bold << fixture.get_name() << plain << separator
+      << pf_t { outcome.ok };
+  if (shows_times) {
+    strm
+        << separator << dur_t { outcome.wall } << " wall"
+        << separator << dur_t { outcome.cpu } << " cpu";
+  }
+  if (shows_allocs) {
+    const auto &allocs = outcome.allocs;
+    strm
+        << separator << allocs.cnt << " allocs"
+        << separator << allocs.bytes << " bytes"
+        << separator << "peak " << allocs.peak_bytes << " bytes";
+  }
+  /* Lick's lines end with a plain newline, and its report stream is flushed
+     once a fixture, here, so that a run makes few calls to write(). */
+  strm << '\n' << std::flush;
+}
+
+void ctxt_t::share() {
+  shared = true;
+  strm.flush();
+}
+
+void ctxt_t::add_note(note_t note) {
+  alloc_pause_t pause;
+  if (!note.ok) {
+    fail();
+  }
+  outcome.notes.push_back(std::move(note));
+}
+
+const outcome_t &ctxt_t::stop() {
+  if (!stopped) {
+    outcome.wall = get_wall_time() - start_wall;
+    outcome.cpu = get_cpu_time() - start_cpu;
+    if (cfg.tracks_allocs() && fixture && !fixture->get_async()) {
+      meter.on = false;
+      outcome.allocs = meter.get_allocs();
+    }
+    if (cfg.counts_events() && fixture && !fixture->is_bench()
+        && !fixture->get_async()) {
+      outcome.counters = counter.stop();
+    }
+    stopped = true;
+  }
+  return outcome;
+}
+
+void ctxt_t::on_begin_show() const {
+  if (showing || !fixture) {
+    return;
+  }
+  showing = true;
+  alloc_pause_t pause;
+  write_begin(strm, *fixture);
+}
+
+void ctxt_t::on_end_show() const {
+  if (!showing) {
+    return;
+  }
+  write_end(
+      strm, *fixture, outcome, cfg.get_verbosity() >= 2,
+      cfg.tracks_allocs());
+}
+
+thread_local ctxt_t *ctxt_t::singleton = nullptr;
+
+std::atomic<bool> ctxt_t::shows_passes { false };
+
+#if defined(LICK_FIXTURE_SECTION)
+/* The bounds of the section into which the linker gathers the fixtures'
+   records.  The linker defines these for any section named like an
+   identifier; they're weak so that a program with no fixtures still links. */
+extern const fixture_t fixture_records_start[]
+    __asm__("__start_lick_fixtures") __attribute__((weak));
+extern const fixture_t fixture_records_stop[]
+    __asm__("__stop_lick_fixtures") __attribute__((weak));
+#else
+// The fixtures enrolled so far, in the order in which they were.
+static std::vector<const fixture_t *> &get_enrolled_fixtures() {
+  static std::vector<const fixture_t *> fixtures;
+  return fixtures;
+}
+
+void enroll_fixture(const fixture_t &fixture) {
+  get_enrolled_fixtures().push_back(&fixture);
+}
+#endif
+
+fixture_t::fixture_t(
+    const fixture_t &place, const void *row_, const char *name_)
+    : loc(place.loc), name(name_), tags(nullptr), fn(nullptr),
+      bench_fn(nullptr), stress_fn(nullptr), async(nullptr),
+      param(place.param), resources(place.resources), row(row_),
+      timeout(0), thread_cnt(0) {}
+
+bool fixture_t::uses(const resource_t &resource) const noexcept {
+  for (auto *iter = resources; iter && *iter; ++iter) {
+    if (*iter == &resource) {
+      return true;
+    }
+  }  // for
+  return false;
+}
+
+// Counts the fixture among the users of its resources, once it's been chosen
+// to run.
+static void add_resource_users(const fixture_t &fixture) {
+  for (auto *iter = fixture.get_resources(); iter && *iter; ++iter) {
+    (*iter)->add_user();
+  }  // for
+}
+
+// Drops the fixture from among the users of its resources, once it's done.
+static void drop_resource_users(const fixture_t &fixture) noexcept {
+  for (auto *iter = fixture.get_resources(); iter && *iter; ++iter) {
+    (*iter)->drop_user();
+  }  // for
+}
+
+outcome_t fixture_t::run(const cfg_t &cfg, std::ostream &strm) const {
+  auto outcome = [&] {
+    ctxt_t ctxt { this, cfg, strm };
+    auto stalled = bench_fn
+        ? stall([&] { run_bench(ctxt); })
+        : stress_fn
+        ? stall([&] { run_stress(ctxt); })
+        : async
+        ? stall([&] { run_async(ctxt); })
+        : param
+        ? stall([&] { param->run_row(row); })
+        : stall(fn);
+    return conclude(ctxt, stalled);
+  }();
+  /* The resources are dropped only once the context is gone, so that
+     tearing them down counts against nothing. */
+  drop_resource_users(*this);
+  return outcome;
+}
+
+outcome_t fixture_t::conclude(
+    ctxt_t &ctxt, const stalled_t<void> &stalled) const {
+  const auto &cfg = ctxt.get_cfg();
+  if (!stalled) {
+    ctxt.add_note(note_t { "exception", loc, false, stalled.msg });
+    ctxt.get_strm()
+        << indent_t { 1 }
+        << red << "exception" << plain << separator
+        << stalled.msg << '\n';
+  }
+  /* An exception leaves its message behind, so only a fixture which
+     returned is checked for leaks. */
+  const auto &outcome = ctxt.stop();
+  /* A benchmark's counters sit beside its timings, which show at a
+     lower verbosity than a test's expectations. */
+  if (outcome.counters.counted
+      && cfg.get_verbosity() >= (is_bench() ? 1 : 2)) {
+    ctxt.get_strm()
+        << indent_t { 1 }
+        << bold << "counters" << plain << separator
+        << outcome.counters << '\n';
+  }
+  const auto &allocs = outcome.allocs;
+  if (stalled && cfg.fails_leaks() && allocs.leak_cnt) {
+    std::ostringstream msg;
+    msg
+        << "leaked " << allocs.leak_bytes << " bytes in " << allocs.leak_cnt
+        << " allocations";
+    ctxt.add_note(note_t { "leak", loc, false, msg.str() });
+    ctxt.get_strm()
+        << indent_t { 1 }
+        << red << "leak" << plain << separator
+        << msg.str() << '\n';
+  }
+  return ctxt.stop();
+}
+
+// Calibrates the benchmark, growing its iteration count until one sample
+// takes a tenth of the target time, then takes ten samples and reports the
+// mean time per iteration, its standard deviation, and the iteration count.
+// The calibration runs double as a warm-up.
+void fixture_t::run_bench(ctxt_t &ctxt) const {
+  static constexpr int sample_cnt = 10;
+  static constexpr std::size_t max_iter_cnt = 1000000000;
+  using sec_t = std::chrono::duration<double>;
+  double target = ctxt.get_cfg().get_bench_time() / sample_cnt;
+  auto sample = [&](std::size_t iter_cnt) {
+    state_t state { iter_cnt };
+    bench_fn(state);
+    return std::chrono::duration_cast<sec_t>(state.get_elapsed()).count();
+  };
+  std::size_t iter_cnt = 1;
+  for (;;) {
+    double elapsed = sample(iter_cnt);
+    if (elapsed >= target || iter_cnt >= max_iter_cnt) {
+      break;
+    }
+    /* Aim a little past the target, but grow no more than tenfold at a time
+       in case this run was unrepresentatively quick. */
+    double scale = (elapsed > 0) ? (target * 1.2 / elapsed) : 10;
+    auto next_cnt = static_cast<std::size_t>(
+        static_cast<double>(iter_cnt) * ((scale > 10) ? 10 : scale));
+    iter_cnt = (next_cnt <= iter_cnt) ? iter_cnt + 1
+        : (next_cnt > max_iter_cnt) ? max_iter_cnt : next_cnt;
+  }
+  double sum = 0, sum_sq = 0;
+  std::vector<double> samples;
+  const auto &cfg = ctxt.get_cfg();
+  event_counter_t counter { cfg.counts_events() };
+  for (int i = 0; i < sample_cnt; ++i) {
+    double ns_per_op = sample(iter_cnt) * 1e9 / static_cast<double>(iter_cnt);
+    samples.push_back(ns_per_op);
+    sum += ns_per_op;
+    sum_sq += ns_per_op * ns_per_op;
+  }
+  if (cfg.counts_events()) {
+    ctxt.set_counters(
+        counter.stop(static_cast<long long>(sample_cnt * iter_cnt)));
+  }
+  double mean = sum / sample_cnt;
+  double var = (sum_sq - sum * mean) / (sample_cnt - 1);
+  double dev = (var > 0) ? std::sqrt(var) : 0;
+  if (cfg.get_verbosity() >= 1) {
+    std::ostringstream line;
+    line
+        << std::setprecision(4)
+        << indent_t { 1 }
+        << bold << "bench" << plain << separator
+        << mean << " ns/op" << separator
+        << "+/- " << dev << " ns/op ("
+        << ((mean > 0) ? (dev * 100 / mean) : 0) << "%)" << separator
+        << sample_cnt << " x " << iter_cnt << " iterations";
+    ctxt.get_strm() << line.str() << '\n';
+  }
+  const auto *baseline = cfg.get_baseline();
+  const auto *then = baseline ? baseline->find(name) : nullptr;
+  if (then && !then->empty()) {
+    /* A regression must be both significant and big enough to matter. */
+    static constexpr double alpha = 0.05;
+    double then_median = get_median(*then), now_median = get_median(samples);
+    double change = (then_median > 0)
+        ? (now_median - then_median) / then_median : 0;
+    double p = get_greater_p(*then, samples);
+    bool ok = p >= alpha || change <= cfg.get_regression_threshold();
+    std::ostringstream msg;
+    msg
+        << std::setprecision(4)
+        << then_median << " ns/op -> " << now_median << " ns/op ("
+        << std::showpos << change * 100 << std::noshowpos << "%)"
+        << separator << "p=" << p;
+    if (!ok) {
+      ctxt.add_note(note_t { "regression", loc, false, msg.str() });
+      ctxt.get_strm()
+          << indent_t { 1 }
+          << red << "regression" << plain << separator
+          << msg.str() << '\n';
+    } else if (cfg.get_verbosity() >= 1) {
+      ctxt.get_strm()
+          << indent_t { 1 }
+          << bold << "baseline" << plain << separator
+          << msg.str() << '\n';
+    }
+  }
+  ctxt.set_samples(std::move(samples));
+}
+
+// Runs a stress fixture's function on its threads, which wait at a barrier
+// until all have started, then reports each thread's throughput.  The
+// threads report to the fixture's context, which is shared for the
+// duration.
+void fixture_t::run_stress(ctxt_t &ctxt) const {
+  struct stats_t final {
+    std::uint64_t op_cnt;
+    double wall;
+  };
+  auto cnt = static_cast<std::size_t>(std::max(thread_cnt, 1));
+  std::vector<stats_t> stats(cnt, stats_t { 0, 0 });
+  std::atomic<std::size_t> ready_cnt { 0 };
+  std::atomic<bool> go { false };
+  ctxt.share();
+  auto work = [&](std::size_t thread_idx) {
+    ctxt_t::guest_t guest { ctxt };
+    auto &mine = stats[thread_idx];
+    ++ready_cnt;
+    while (!go.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }  // while
+    /* The count lives on the thread's own stack, so that counting doesn't
+       contend for the cache line it shares with the other threads' stats. */
+    std::uint64_t op_cnt = 0;
+    auto start = get_wall_time();
+    auto stalled = stall(stress_fn, thread_idx, op_cnt);
+    mine.wall = get_wall_time() - start;
+    mine.op_cnt = op_cnt;
+    if (!stalled) {
+      std::ostringstream msg;
+      msg << "thread " << thread_idx << separator << stalled.msg;
+      std::lock_guard<std::mutex> lock { ctxt.get_mutex() };
+      ctxt.add_note(note_t { "exception", loc, false, msg.str() });
+      ctxt.get_strm()
+          << indent_t { 1 }
+          << red << "exception" << plain << separator
+          << msg.str() << '\n' << std::flush;
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(cnt);
+  for (std::size_t thread_idx = 0; thread_idx < cnt; ++thread_idx) {
+    threads.emplace_back(work, thread_idx);
+  }  // for
+  while (ready_cnt.load() < cnt) {
+    std::this_thread::yield();
+  }  // while
+  go.store(true, std::memory_order_release);
+  for (auto &thread : threads) {
+    thread.join();
+  }  // for
+  if (ctxt.get_cfg().get_verbosity() < 1) {
+    return;
+  }
+  std::ostringstream lines;
+  lines << std::setprecision(4);
+  std::uint64_t total_ops = 0;
+  double max_wall = 0;
+  for (std::size_t thread_idx = 0; thread_idx < cnt; ++thread_idx) {
+    const auto &mine = stats[thread_idx];
+    lines
+        << indent_t { 1 }
+        << bold << "stress" << plain << separator
+        << "thread " << thread_idx << separator
+        << dur_t { mine.wall } << " wall";
+    if (mine.op_cnt) {
+      lines
+          << separator << mine.op_cnt << " ops" << separator
+          << ((mine.wall > 0) ? static_cast<double>(mine.op_cnt) / mine.wall
+              : 0) << " ops/s";
+    }
+    lines << '\n';
+    total_ops += mine.op_cnt;
+    max_wall = std::max(max_wall, mine.wall);
+  }  // for
+  lines
+      << indent_t { 1 }
+      << bold << "stress" << plain << separator
+      << cnt << " threads" << separator
+      << dur_t { max_wall } << " wall";
+  if (total_ops) {
+    lines
+        << separator << total_ops << " ops" << separator
+        << ((max_wall > 0) ? static_cast<double>(total_ops) / max_wall : 0)
+        << " ops/s";
+  }
+  ctxt.get_strm() << lines.str() << '\n';
+}
+
+// Appends the records of a span to 'records', in order by file and then by
+// line.
+static void add_fixture_records(
+    const fixture_t::span_t &span, std::vector<const fixture_t *> &records) {
+  /* The linker lays out the translation units in link order, and the
+     compiler may lay out the records of a translation unit in any order;
+     GCC lays them out backwards.  So the records are taken in runs which
+     share a source file, the runs are put in order by file, and then each
+     run is put in order by line, which usually just means reversing it. */
+  struct run_t final {
+    const char *file;
+    const fixture_t *start, *stop;
+  };
+  std::vector<run_t> runs;
+  for (auto *fixture = span.start; fixture < span.stop; ) {
+    auto *start = fixture;
+    auto *file = fixture->get_loc().get_file();
+    while (++fixture < span.stop
+        && fixture->get_loc().get_file() == file) {}
+    runs.push_back({ file, start, fixture });
+  }  // for
+  std::stable_sort(
+      runs.begin(), runs.end(),
+      [](const run_t &lhs, const run_t &rhs) {
+        return std::strcmp(lhs.file, rhs.file) < 0;
+      });
+  auto precedes = [](const fixture_t *lhs, const fixture_t *rhs) {
+    return lhs->get_loc().get_line() < rhs->get_loc().get_line();
+  };
+  auto follows = [](const fixture_t *lhs, const fixture_t *rhs) {
+    return lhs->get_loc().get_line() > rhs->get_loc().get_line();
+  };
+  records.reserve(
+      records.size() + static_cast<std::size_t>(span.stop - span.start));
+  for (const auto &run : runs) {
+    auto start = records.size();
+    for (auto *fixture = run.start; fixture < run.stop; ++fixture) {
+      records.push_back(fixture);
+    }  // for
+    auto first = records.begin() + static_cast<std::ptrdiff_t>(start);
+    if (std::is_sorted(first, records.end(), precedes)) {
+      continue;
+    }
+    if (std::is_sorted(first, records.end(), follows)) {
+      std::reverse(first, records.end());
+    } else {
+      std::stable_sort(first, records.end(), precedes);
+    }
+  }  // for
+}
+
+// The records which for_each() enumerates: the program's own, unless
+// set_records() has put others in their place.
+static std::vector<const fixture_t *> &get_fixture_records() {
+  static std::vector<const fixture_t *> records = [] {
+#if defined(LICK_FIXTURE_SECTION)
+    std::vector<const fixture_t *> records;
+    add_fixture_records(
+        fixture_t::span_t { fixture_records_start, fixture_records_stop },
+        records);
+    return records;
+#else
+    return get_enrolled_fixtures();
+#endif
+  }();
+  return records;
+}
+
+// The rows of a parameterized fixture as fixtures, and their names, back to
+// back, each terminated by a null.
+struct param_rows_t final {
+
+  std::string names;
+
+  std::deque<fixture_t> rows;
+
+};  // param_rows_t
+
+// The rows of the parameterized fixtures, by place holder, made the first
+// time each place holder is enumerated.  They're kept here rather than in the
+// place holders, which are constant, so that declaring a parameterized
+// fixture costs no static initialization.
+static std::map<const fixture_t *, param_rows_t> &get_param_rows() {
+  static std::map<const fixture_t *, param_rows_t> rows;
+  return rows;
+}
+
+void fixture_t::set_records(const std::vector<span_t> &spans) {
+  auto &records = get_fixture_records();
+  records.clear();
+  /* The place holders may be gone, and others may take their addresses. */
+  get_param_rows().clear();
+  for (const auto &span : spans) {
+    add_fixture_records(span, records);
+  }  // for
+}
+
+const std::deque<fixture_t> &fixture_t::get_rows(const fixture_t &place) {
+  auto &param_rows = get_param_rows();
+  auto iter = param_rows.find(&place);
+  if (iter != param_rows.end()) {
+    return iter->second.rows;
+  }
+  auto &rows = param_rows[&place];
+  /* Name all the rows before pointing at any of their names, as the
+     buffer may move as it grows. */
+  std::vector<const void *> addrs;
+  std::vector<std::size_t> offsets;
+  place.param->for_each_row(
+    [&](const void *row) {
+      offsets.push_back(rows.names.size());
+      rows.names += place.name;
+      rows.names += '/';
+      rows.names += std::to_string(addrs.size());
+      rows.names += '\0';
+      addrs.push_back(row);
+    }
+  );
+  for (std::size_t row_idx = 0; row_idx < addrs.size(); ++row_idx) {
+    rows.rows.emplace_back(
+        place, addrs[row_idx], rows.names.data() + offsets[row_idx]);
+  }  // for
+  return rows.rows;
+}
+
+bool fixture_t::for_each(const cb_t &cb) {
+  for (auto *fixture : get_fixture_records()) {
+    if (!fixture->param) {
+      if (!cb(*fixture)) {
+        return false;
+      }
+      continue;
+    }
+    for (const auto &row : get_rows(*fixture)) {
+      if (!cb(row)) {
+        return false;
+      }
+    }  // for
+  }  // for
+  return true;
+}
+
+resource_t::~resource_t() = default;
+
+void resource_t::drop_user() noexcept {
+  /* A fixture run other than by the runner wasn't counted, so the count
+     mustn't go below zero. */
+  auto cnt = user_cnt.load(std::memory_order_relaxed);
+  do {
+    if (cnt <= 0) {
+      return;
+    }
+  } while (!user_cnt.compare_exchange_weak(cnt, cnt - 1));
+  if (cnt == 1) {
+    std::lock_guard<std::mutex> lock { mutex };
+    if (built.load(std::memory_order_relaxed)) {
+      alloc_pause_t pause;
+      tear_down();
+      built.store(false, std::memory_order_relaxed);
+    }
+  }
+}
+
+void resource_t::acquire() {
+  auto *ctxt = ctxt_t::get_singleton();
+  const auto *fixture = ctxt ? ctxt->get_fixture() : nullptr;
+  if (fixture && !fixture->uses(*this)) {
+    std::ostringstream msg;
+    msg
+        << "fixture " << fixture->get_name() << " uses resource " << name
+        << " without naming it in FIXTURE_USING";
+    throw std::logic_error { msg.str() };
+  }
+  if (built.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock { mutex };
+  if (built.load(std::memory_order_relaxed)) {
+    return;
+  }
+  /* What the resource allocates outlives the fixture, and so mustn't count
+     against it, nor look like a leak. */
+  alloc_pause_t pause;
+  auto start_wall = get_wall_time(), start_cpu = get_cpu_time();
+  build();
+  auto wall = get_wall_time() - start_wall, cpu = get_cpu_time() - start_cpu;
+  built.store(true, std::memory_order_release);
+  if (!ctxt) {
+    return;
+  }
+  std::unique_lock<std::mutex> ctxt_lock;
+  if (ctxt->is_shared()) {
+    ctxt_lock = std::unique_lock<std::mutex> { ctxt->get_mutex() };
+  }
+  ctxt->exclude(wall, cpu);
+  if (fixture && ctxt->get_cfg().get_verbosity() >= 1) {
+    ctxt->get_strm()
+        << indent_t { 1 }
+        << bold << "setup" << plain << separator
+        << name << separator
+        << dur_t { wall } << " wall" << separator
+        << dur_t { cpu } << " cpu" << '\n';
+  }
+}
+
+any_operand_t::~any_operand_t() = default;
+
+predicate_t::~predicate_t() = default;
+
+void predicate_t::write_src(std::ostream &strm) const {
+  const char *name = get_name();
+  strm << "EXPECT";
+  if (*name) {
+    strm << '_' << name;
+  }
+  strm << '(';
+  bool needs_comma = false;
+  for_each_operand(
+    [&](const any_operand_t &operand) {
+      if (needs_comma) {
+        strm << ", ";
+      } else {
+        needs_comma = true;
+      }
+      strm << src_of(operand);
+      return true;
+    }
+  );
+  strm << ')';
+}
+
+void predicate_t::write_details(std::ostream &) const {}
+
+bool unary_t::for_each_operand(const cb_t &cb) const {
+  return cb(operand);
+}
+
+bool binary_t::for_each_operand(const cb_t &cb) const {
+  return cb(lhs) && cb(rhs);
+}
+
+bool ternary_t::for_each_operand(const cb_t &cb) const {
+  return cb(lhs) && cb(rhs) && cb(coef);
+}
+
+namespace predicate {
+
+const char *true_t::get_name() const {
+  return "";
+}
+
+const char *false_t::get_name() const {
+  return "NOT";
+}
+
+const char *eq_t::get_name() const {
+  return "EQ";
+}
+
+const char *ne_t::get_name() const {
+  return "NE";
+}
+
+const char *lt_t::get_name() const {
+  return "LT";
+}
+
+const char *le_t::get_name() const {
+  return "LE";
+}
+
+const char *gt_t::get_name() const {
+  return "GT";
+}
+
+const char *ge_t::get_name() const {
+  return "GE";
+}
+
+const char *almost_eq_t::get_name() const {
+  return "ALMOST_EQ";
+}
+
+const char *duration_lt_t::get_name() const {
+  return "DURATION_LT";
+}
+
+const char *percentile_lt_t::get_name() const {
+  return "PERCENTILE_LT";
+}
+
+const char *per_op_lt_t::get_name() const {
+  return "PER_OP_LT";
+}
+
+const char *no_alloc_t::get_name() const {
+  return "NO_ALLOC";
+}
+
+const char *allocs_le_t::get_name() const {
+  return "ALLOCS_LE";
+}
+
+const char *range_almost_eq_t::get_name() const {
+  return "RANGE_ALMOST_EQ";
+}
+
+const char *not_almost_eq_t::get_name() const {
+  return "NOT_ALMOST_EQ";
+}
+
+}  // predicate
+
+class report_t final {
+public:
+
+  report_t(ctxt_t *ctxt_, const loc_t &loc_, bool ok_)
+      : ctxt(ctxt_), loc(loc_), ok(ok_) {}
+
+  report_t(const report_t &) = delete;
+
+  report_t &operator=(const report_t &) = delete;
+
+  ctxt_t *ctxt;
+
+  loc_t loc;
+
+  bool ok;
+
+  // The description of the predicate and its operands.
+  std::string desc;
+
+  // The extra message streamed into the expectation.
+  std::ostringstream extra;
+
+};  // report_t
+
+report_t *expectation_t::begin_report(
+    loc_t loc, const predicate_t &predicate) {
+  bool ok = predicate;
+  if (ok && ctxt_t::hides_passes()) {
+    return nullptr;
+  }
+  alloc_pause_t pause;
+  std::unique_ptr<report_t> report {
+    new report_t { ctxt_t::get_singleton(), loc, ok }
+  };
+  std::ostringstream strm;
+  strm << src_of(predicate);
+  predicate.for_each_operand(
+    [&](const any_operand_t &operand) {
+      const char *src = operand.get_src();
+      if (!isdigit(*src) && *src != '\'' && *src != '"') {
+        strm << separator << src << '=' << val_of(operand);
+      }
+      return true;
+    }
+  );
+  predicate.write_details(strm);
+  report->desc = strm.str();
+  return report.release();
+}
+
+void expectation_t::end_report(report_t *report) noexcept {
+  alloc_pause_t pause;
+  std::unique_ptr<report_t> owned { report };
+  auto msg = std::move(owned->desc);
+  auto extra = owned->extra.str();
+  if (!extra.empty()) {
+    msg += separator;
+    msg += extra;
+  }
+  auto *ctxt = owned->ctxt;
+  if (!ctxt) {
+    /* Only a failure gets this far without a context, which is to say on a
+       thread of the fixture's own making.  There's no report to add the
+       failure to, nor any safe way to fail the fixture, so the failure goes
+       to stderr and the process stops, as an assertion would. */
+    std::cerr
+        << owned->loc << separator
+        << pf_t { false } << separator
+        << msg << separator
+        << "no fixture is running on this thread; check from several threads "
+        << "with STRESS_FIXTURE; aborting" << std::endl;
+    std::abort();
+  }
+  std::unique_lock<std::mutex> lock { ctxt->get_mutex(), std::defer_lock };
+  if (ctxt->is_shared()) {
+    lock.lock();
+  }
+  auto &strm = ctxt->get_strm();
+  strm
+      << indent_t { 1 }
+      << owned->loc << separator
+      << pf_t { owned->ok } << separator
+      << msg << '\n';
+  /* Each thread of a shared context may buffer its output apart, so send
+     the line on its way while the lock keeps the lines in order. */
+  if (lock) {
+    strm.flush();
+  }
+  ctxt->add_note(note_t { "expect", owned->loc, owned->ok, std::move(msg) });
+}
+
+std::ostream &expectation_t::get_extra_strm(report_t *report) {
+  return report->extra;
+}
+
+alloc_region_t::alloc_region_t(
+    const loc_t &loc_, const char *limit_src_, std::size_t limit_) noexcept
+    : loc(loc_), limit_src(limit_src_), limit(limit_),
+      start_cnt(static_cast<std::size_t>(meter.cnt)),
+      start_bytes(static_cast<std::size_t>(meter.bytes)), was_on(meter.on),
+      done(false) {
+  meter.on = true;
+}
+
+alloc_region_t::~alloc_region_t() {
+  meter.on = was_on;
+}
+
+#if defined(LICK_NO_ALLOC_HOOKS)
+
+// The allocation count of a region when there are no hooks to count with.
+// It meets no limit, so that such a region fails rather than passing for
+// want of anything to count.
+class uncounted_t final {
+public:
+
+  template <typename limit_t>
+  friend bool operator==(const uncounted_t &, const limit_t &) noexcept {
+    return false;
+  }
+
+  template <typename limit_t>
+  friend bool operator<=(const uncounted_t &, const limit_t &) noexcept {
+    return false;
+  }
+
+  friend std::ostream &operator<<(std::ostream &strm, const uncounted_t &) {
+    return strm << "not counted";
+  }
+
+};  // uncounted_t
+
+#endif
+
+// Checks the allocation count of a region against its limit, or against
+// none, if the limit has no source.
+template <typename cnt_t, typename extra_t>
+static void check_allocs(
+    const loc_t &loc, const char *limit_src, std::size_t limit,
+    const cnt_t &cnt, const extra_t &extra) {
+  if (limit_src) {
+    expectation_t {
+      loc,
+      ::lick::check<predicate::allocs_le_t>(
+          as_operand("allocs", cnt), as_operand(limit_src, limit))
+    } << extra;
+  } else {
+    expectation_t {
+      loc, ::lick::check<predicate::no_alloc_t>(as_operand("allocs", cnt))
+    } << extra;
+  }
+}
+
+void alloc_region_t::check() {
+  auto cnt = static_cast<std::size_t>(meter.cnt) - start_cnt;
+  auto bytes = static_cast<std::size_t>(meter.bytes) - start_bytes;
+  meter.on = was_on;
+  alloc_pause_t pause;
+#if defined(LICK_NO_ALLOC_HOOKS)
+  static_cast<void>(cnt);
+  static_cast<void>(bytes);
+  check_allocs(
+      loc, limit_src, limit, uncounted_t {},
+      "lick was built with LICK_NO_ALLOC_HOOKS");
+#else
+  check_allocs(
+      loc, limit_src, limit, cnt, std::to_string(bytes) + " bytes");
+#endif
+}
+
+namespace gen {
+
+strings_t::strings_t(std::size_t max_size_, std::string alphabet_)
+    : max_size(max_size_), alphabet(std::move(alphabet_)) {
+  if (alphabet.empty()) {
+    for (char c = ' '; c <= '~'; ++c) {
+      alphabet += c;
+    }
+  }
+}
+
+std::string strings_t::operator()(rng_t &rng, std::size_t size) const {
+  std::string val;
+  auto len = rng.below((max_size * size + 99) / 100 + 1);
+  for (std::uint64_t i = 0; i < len; ++i) {
+    val += alphabet[rng.below(alphabet.size())];
+  }
+  return val;
+}
+
+std::vector<std::string> strings_t::shrink(const std::string &val) const {
+  std::vector<std::string> vals;
+  if (val.empty()) {
+    return vals;
+  }
+  vals.emplace_back();
+  for (auto run = val.size() / 2; run; run /= 2) {
+    for (std::size_t start = 0; start < val.size(); start += run) {
+      vals.push_back(val.substr(0, start) + val.substr(start + run));
+    }  // for
+  }  // for
+  for (std::size_t idx = 0; idx < val.size(); ++idx) {
+    if (val[idx] != alphabet[0]) {
+      vals.push_back(val);
+      vals.back()[idx] = alphabet[0];
+    }
+  }  // for
+  return vals;
+}
+
+void strings_t::write(std::ostream &strm, const std::string &val) const {
+  strm << '"';
+  for (char c : val) {
+    switch (c) {
+      case '"':
+      case '\\': {
+        strm << '\\' << c;
+        break;
+      }
+      default: {
+        if (c >= ' ' && c <= '~') {
+          strm << c;
+        } else {
+          static const char *digits = "0123456789abcdef";
+          auto bits = static_cast<unsigned char>(c);
+          strm << "\\x" << digits[bits >> 4] << digits[bits & 15];
+        }
+      }
+    }
+  }  // for
+  strm << '"';
+}
+
+strings_t strings(std::size_t max_size, std::string alphabet) {
+  return { max_size, std::move(alphabet) };
+}
+
+}  // gen
+
+// The threads which run the cases of one property, round after round.  The
+// crew grows as rounds need more threads, up to its limit, and each round
+// uses all of them.
+class property_t::crew_t final {
+public:
+
+  explicit crew_t(const cfg_t &cfg_)
+      : cfg(cfg_),
+        max_size(std::min<std::size_t>(
+            static_cast<std::size_t>(cfg.get_jobs()),
+            std::max(1u, std::thread::hardware_concurrency()))),
+        run(nullptr), next(0), least(0), round(0), busy_cnt(0),
+        stopping(false) {}
+
+  crew_t(const crew_t &) = delete;
+
+  ~crew_t() {
+    {
+      std::lock_guard<std::mutex> lock { mutex };
+      stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto &thread : threads) {
+      thread.join();
+    }  // for
+  }
+
+  crew_t &operator=(const crew_t &) = delete;
+
+  std::size_t find_failure(std::size_t cnt, const run_t &run_) {
+    std::unique_lock<std::mutex> lock { mutex };
+    while (threads.size() < std::min(max_size, cnt)) {
+      threads.emplace_back([this, seen = round] { work(seen); });
+    }  // while
+    run = &run_;
+    next = 0;
+    least = cnt;
+    busy_cnt = threads.size();
+    ++round;
+    start_cv.notify_all();
+    done_cv.wait(lock, [this] { return busy_cnt == 0; });
+    return least.load();
+  }
+
+private:
+
+  // Works each round after the given one until the crew stops.
+  void work(std::uint64_t seen) {
+    std::ostream null_strm { nullptr };
+    std::unique_lock<std::mutex> lock { mutex };
+    for (;;) {
+      start_cv.wait(lock, [&] { return stopping || round != seen; });
+      if (stopping) {
+        break;
+      }
+      seen = round;
+      lock.unlock();
+      /* Each thread takes the next index until it passes the least failing
+         index yet found, so every index below the one returned has run. */
+      for (;;) {
+        auto idx = next.fetch_add(1);
+        if (idx >= least.load()) {
+          break;
+        }
+        bool ok;
+        {
+          ctxt_t probe { nullptr, cfg, null_strm };
+          ok = stall(*run, idx) && probe;
+        }
+        if (!ok) {
+          auto prev = least.load();
+          while (idx < prev && !least.compare_exchange_weak(prev, idx)) {}
+        }
+      }  // for
+      lock.lock();
+      if (--busy_cnt == 0) {
+        done_cv.notify_one();
+      }
+    }  // for
+  }
+
+  const cfg_t &cfg;
+
+  const std::size_t max_size;
+
+  /* The following describe the current round.  The mutex and the condition
+     variables hand them from the calling thread to the crew and back. */
+  const run_t *run;
+
+  std::atomic<std::size_t> next, least;
+
+  std::uint64_t round;
+
+  std::size_t busy_cnt;
+
+  bool stopping;
+
+  std::mutex mutex;
+
+  std::condition_variable start_cv, done_cv;
+
+  std::vector<std::thread> threads;
+
+};  // property_t::crew_t
+
+property_t::property_t(const loc_t &loc_)
+    : loc(loc_) {
+  const auto *ctxt = ctxt_t::get_singleton();
+  const auto &cfg = ctxt->get_cfg();
+  run_seed = cfg.get_seed();
+  case_cnt = static_cast<std::size_t>(cfg.get_case_cnt());
+  /* Each property gets cases of its own, but they depend only on the seed
+     and the property's name, so the seed reproduces them. */
+  seed = gen::rng_t::mix(run_seed);
+  for (const char *c = ctxt->get_fixture()->get_name(); *c; ++c) {
+    seed = gen::rng_t::mix(seed ^ static_cast<unsigned char>(*c));
+  }
+  crew = std::make_unique<crew_t>(cfg);
+}
+
+property_t::~property_t() = default;
+
+std::size_t property_t::find_failure(std::size_t cnt, const run_t &run) const {
+  return crew->find_failure(cnt, run);
+}
+
+void property_t::pass() const {
+  auto *ctxt = ctxt_t::get_singleton();
+  if (ctxt_t::hides_passes()) {
+    return;
+  }
+  std::ostringstream msg;
+  msg << "PROPERTY; " << case_cnt << " cases; seed " << run_seed;
+  ctxt->get_strm()
+      << indent_t { 1 }
+      << loc << separator
+      << pf_t { true } << separator
+      << msg.str() << '\n';
+  ctxt->add_note(note_t { "property", loc, true, msg.str() });
+}
+
+void property_t::fail(
+    std::size_t case_idx, std::size_t shrink_cnt,
+    const std::string &vals) const {
+  auto *ctxt = ctxt_t::get_singleton();
+  std::ostringstream msg;
+  msg
+      << "PROPERTY; case " << (case_idx + 1) << " of " << case_cnt
+      << " failed; shrunk " << shrink_cnt << " times; seed " << run_seed
+      << separator << vals;
+  ctxt->get_strm()
+      << indent_t { 1 }
+      << loc << separator
+      << pf_t { false } << separator
+      << msg.str() << '\n';
+  ctxt->add_note(note_t { "property", loc, false, msg.str() });
+}
+
+// Counts the fixtures run so far.  Workers update the counts concurrently.
+class tally_t final {
+public:
+
+  tally_t()
+      : pass_cnt(0), fail_cnt(0), skip_cnt(0), cache_cnt(0) {}
+
+  tally_t(const tally_t &) = delete;
+
+  tally_t &operator=(const tally_t &) = delete;
+
+  void count(bool ok) noexcept {
+    ++(ok ? pass_cnt : fail_cnt);
+  }
+
+  void skip() noexcept {
+    ++skip_cnt;
+  }
+
+  void skip_cached() noexcept {
+    ++cache_cnt;
+  }
+
+  std::atomic<int> pass_cnt, fail_cnt, skip_cnt, cache_cnt;
+
+};  // tally_t
+
+// Holds the reports of fixtures running out of order on workers so that they
+// can be written in definition order.
+class board_t final {
+public:
+
+  explicit board_t(std::size_t size)
+      : reports(size), posted(size, false) {}
+
+  board_t(const board_t &) = delete;
+
+  board_t &operator=(const board_t &) = delete;
+
+  // Called by a worker when the fixture at the given index is done.
+  void post(std::size_t idx, std::string report) {
+    std::lock_guard<std::mutex> lock { mutex };
+    reports[idx] = std::move(report);
+    posted[idx] = true;
+    cv.notify_all();
+  }
+
+  // Blocks until the fixture at the given index is done, then returns its
+  // report.
+  std::string take(std::size_t idx) {
+    std::unique_lock<std::mutex> lock { mutex };
+    cv.wait(lock, [&] { return posted[idx]; });
+    return std::move(reports[idx]);
+  }
+
+private:
+
+  std::mutex mutex;
+
+  std::condition_variable cv;
+
+  std::vector<std::string> reports;
+
+  std::vector<bool> posted;
+
+};  // board_t
+
+// A pool of worker threads which calls a job once for each index in
+// [0, job_cnt).  The indices are dealt round-robin into a deque per worker,
+// so the earliest jobs start first.  Each worker takes from the front of its
+// own deque and, when that runs dry, steals from the back of the others'.
+// The destructor waits for all the jobs to finish.
+class pool_t final {
+public:
+
+  using job_t = std::function<void (std::size_t)>;
+
+  pool_t(int worker_cnt, std::size_t job_cnt, job_t job_)
+      : job(std::move(job_)), queues(static_cast<std::size_t>(worker_cnt)) {
+    for (std::size_t idx = 0; idx < job_cnt; ++idx) {
+      queues[idx % queues.size()].idxs.push_back(idx);
+    }
+    for (std::size_t self = 0; self < queues.size(); ++self) {
+      workers.emplace_back([this, self] { work(self); });
+    }
+  }
+
+  pool_t(const pool_t &) = delete;
+
+  ~pool_t() {
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  pool_t &operator=(const pool_t &) = delete;
+
+private:
+
+  struct queue_t final {
+
+    std::mutex mutex;
+
+    std::deque<std::size_t> idxs;
+
+  };  // queue_t
+
+  bool take(std::size_t self, std::size_t &idx) {
+    for (std::size_t i = 0; i < queues.size(); ++i) {
+      auto &queue = queues[(self + i) % queues.size()];
+      std::lock_guard<std::mutex> lock { queue.mutex };
+      if (!queue.idxs.empty()) {
+        if (i == 0) {
+          idx = queue.idxs.front();
+          queue.idxs.pop_front();
+        } else {
+          idx = queue.idxs.back();
+          queue.idxs.pop_back();
+        }
+        return true;
+      }
+    }  // for
+    return false;
+  }
+
+  void work(std::size_t self) {
+    std::size_t idx;
+    while (take(self, idx)) {
+      job(idx);
+    }
+  }
+
+  job_t job;
+
+  std::vector<queue_t> queues;
+
+  std::vector<std::thread> workers;
+
+};  // pool_t
+
+// The fixtures chosen for a run and what came of them.  A runner records the
+// outcome of each fixture with finish(), from any thread and in any order,
+// and then publishes it with publish(), from the calling thread and in
+// definition order.
+class slate_t final {
+public:
+
+  slate_t(const cfg_t &cfg_, tally_t &tally_, double start_time_)
+      : cfg(cfg_), tally(tally_), start_time(start_time_), next_idx(0) {}
+
+  slate_t(const slate_t &) = delete;
+
+  slate_t &operator=(const slate_t &) = delete;
+
+  void add(const fixture_t &fixture) {
+    fixtures.push_back(&fixture);
+    outcomes.emplace_back();
+    finished.push_back(false);
+  }
+
+  void finish(std::size_t idx, outcome_t outcome) {
+    tally.count(outcome.ok);
+    std::lock_guard<std::mutex> lock { mutex };
+    outcomes[idx] = std::move(outcome);
+    finished[idx] = true;
+  }
+
+  // Hands the outcome to the reporters, then drops its notes, which nothing
+  // needs after this.
+  void publish(std::size_t idx) {
+    std::lock_guard<std::mutex> lock { mutex };
+    for (const auto &reporter : cfg.get_reporters()) {
+      reporter->on_fixture(*fixtures[idx], outcomes[idx]);
+    }
+    outcomes[idx].notes = std::vector<note_t> {};
+    next_idx = idx + 1;
+  }
+
+  // Cuts the run short on the reporters, for a process about to abort because
+  // the given fixture ran too long.  The reporters hear, in order, about the
+  // fixtures which finished but weren't yet published and about the given
+  // one, with the given outcome, and then the run ends.  Publishing stops for
+  // good.
+  void abandon(const fixture_t &fixture, outcome_t outcome) {
+    mutex.lock();
+    tally.count(outcome.ok);
+    const auto &reporters = cfg.get_reporters();
+    for (auto idx = next_idx; idx < fixtures.size(); ++idx) {
+      if (fixtures[idx] == &fixture) {
+        finished[idx] = true;
+        outcomes[idx] = std::move(outcome);
+      }
+      if (!finished[idx]) {
+        continue;
+      }
+      for (const auto &reporter : reporters) {
+        reporter->on_fixture(*fixtures[idx], outcomes[idx]);
+      }  // for
+    }  // for
+    summary_t summary {
+      tally.pass_cnt, tally.fail_cnt, tally.skip_cnt, tally.cache_cnt, false,
+      get_wall_time() - start_time
+    };
+    for (const auto &reporter : reporters) {
+      reporter->on_end_run(summary);
+    }  // for
+  }
+
+  std::size_t size() const noexcept {
+    return fixtures.size();
+  }
+
+  const cfg_t &cfg;
+
+  tally_t &tally;
+
+  std::vector<const fixture_t *> fixtures;
+
+  std::vector<outcome_t> outcomes;
+
+private:
+
+  const double start_time;
+
+  /* Covers the outcomes and the following, so that abandon() can't race
+     with a worker or with the calling thread. */
+  std::mutex mutex;
+
+  std::vector<bool> finished;
+
+  std::size_t next_idx;
+
+};  // slate_t
+
+// Watches over fixtures running in this process.  If one runs past its
+// timeout, the watchdog reports it and aborts the process, since there is no
+// safe way to stop a single thread.  The watchdog's thread starts only when
+// the first fixture with a timeout does.
+class watchdog_t final {
+public:
+
+  // Watches one fixture for as long as it lives.
+  class watch_t final {
+  public:
+
+    watch_t(watchdog_t &watchdog_, const fixture_t &fixture)
+        : watchdog(watchdog_), id(watchdog.arm(fixture)) {}
+
+    watch_t(const watch_t &) = delete;
+
+    ~watch_t() {
+      watchdog.disarm(id);
+    }
+
+    watch_t &operator=(const watch_t &) = delete;
+
+  private:
+
+    watchdog_t &watchdog;
+
+    std::uint64_t id;
+
+  };  // watch_t
+
+  explicit watchdog_t(slate_t &slate_)
+      : slate(slate_), cfg(slate_.cfg), next_id(1), stopping(false) {}
+
+  watchdog_t(const watchdog_t &) = delete;
+
+  ~watchdog_t() {
+    {
+      std::lock_guard<std::mutex> lock { mutex };
+      stopping = true;
+      cv.notify_all();
+    }
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  watchdog_t &operator=(const watchdog_t &) = delete;
+
+private:
+
+  struct entry_t final {
+
+    const fixture_t *fixture;
+
+    double timeout;
+
+    std::chrono::steady_clock::time_point deadline;
+
+  };  // entry_t
+
+  // Returns an id to pass to disarm(), or 0 if the fixture has no timeout.
+  std::uint64_t arm(const fixture_t &fixture) {
+    double timeout = fixture.get_timeout(cfg);
+    if (timeout <= 0) {
+      return 0;
+    }
+    auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double> { timeout });
+    std::lock_guard<std::mutex> lock { mutex };
+    if (!thread.joinable()) {
+      thread = std::thread { [this] { watch(); } };
+    }
+    auto id = next_id++;
+    entries[id] = entry_t { &fixture, timeout, deadline };
+    cv.notify_all();
+    return id;
+  }
+
+  void disarm(std::uint64_t id) {
+    if (id) {
+      std::lock_guard<std::mutex> lock { mutex };
+      entries.erase(id);
+    }
+  }
+
+  void watch() {
+    std::unique_lock<std::mutex> lock { mutex };
+    while (!stopping) {
+      auto soonest = entries.end();
+      for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
+        if (soonest == entries.end()
+            || iter->second.deadline < soonest->second.deadline) {
+          soonest = iter;
+        }
+      }  // for
+      if (soonest == entries.end()) {
+        cv.wait(lock);
+      } else if (std::chrono::steady_clock::now() < soonest->second.deadline) {
+        cv.wait_until(lock, soonest->second.deadline);
+      } else {
+        on_expire(soonest->second);
+      }
+    }  // while
+  }
+
+  [[noreturn]] void on_expire(const entry_t &entry) {
+    auto &strm = cfg.get_strm();
+    strm
+        << entry.fixture->get_loc() << separator
+        << red << "timeout" << plain << ' '
+        << bold << entry.fixture->get_name() << plain << separator
+        << "ran longer than " << dur_t { entry.timeout } << separator
+        << "aborting" << '\n';
+    strm.flush();
+    std::ostringstream msg;
+    msg << "ran longer than " << dur_t { entry.timeout };
+    outcome_t outcome {};
+    outcome.ok = false;
+    outcome.wall = entry.timeout;
+    outcome.notes.push_back(
+        note_t { "timeout", entry.fixture->get_loc(), false, msg.str() });
+    slate.abandon(*entry.fixture, std::move(outcome));
+    std::abort();
+  }
+
+  slate_t &slate;
+
+  const cfg_t &cfg;
+
+  std::mutex mutex;
+
+  std::condition_variable cv;
+
+  std::map<std::uint64_t, entry_t> entries;
+
+  std::uint64_t next_id;
+
+  bool stopping;
+
+  std::thread thread;
+
+};  // watchdog_t
+
+// Writes all of a buffer to a file descriptor, riding out short writes and
+// interruptions.  False, with errno set, if the write fails.  Safe to call
+// from a signal handler.
+static bool try_write_fd(int fd, const char *data, std::size_t size) noexcept {
+  while (size) {
+    auto actual = ::write(fd, data, size);
+    if (actual < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += actual;
+    size -= static_cast<std::size_t>(actual);
+  }
+  return true;
+}
+
+// As try_write_fd(), but throws if the write fails.
+static void write_fd(int fd, const char *data, std::size_t size) {
+  if (!try_write_fd(fd, data, size)) {
+    throw std::system_error { errno, std::system_category(), "write" };
+  }
+}
+
+// A forked child reports to its parent over a pipe in frames.  Each frame is
+// a kind byte, the index of the fixture it concerns, the size of its payload,
+// and then the payload itself.
+enum class frame_kind_t : char {
+
+  // The child has begun the fixture.  No payload.
+  begin = 'b',
+
+  // Part of the fixture's report.
+  out = 'o',
+
+  // Part of what the child wrote to its standard output and error while the
+  // fixture ran.
+  captured = 'c',
+
+  // The child has finished the fixture.  The payload is its serialized
+  // outcome_t.
+  end = 'e'
+
+};  // frame_kind_t
+
+struct frame_hdr_t final {
+
+  frame_kind_t kind;
+
+  std::uint32_t idx, size;
+
+};  // frame_hdr_t
+
+static void write_frame(
+    int fd, frame_kind_t kind, std::size_t idx,
+    const char *data = nullptr, std::size_t size = 0) {
+  frame_hdr_t hdr {
+    kind, static_cast<std::uint32_t>(idx), static_cast<std::uint32_t>(size)
+  };
+  write_fd(fd, reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+  write_fd(fd, data, size);
+}
+
+// In a forked child, the file to which its standard output and error go, or
+// -1, and how much of that file has been sent to the parent so far.
+static int capture_fd = -1;
+static off_t capture_sent = 0;
+
+// Sends what the child has written to its standard output and error since
+// last time to the parent, as part of the report of the given fixture,
+// without throwing, from a signal handler or otherwise.
+static void send_captured(int fd, std::size_t idx) noexcept {
+  if (capture_fd < 0) {
+    return;
+  }
+  char buf[4096];
+  for (;;) {
+    auto size = pread(capture_fd, buf, sizeof(buf), capture_sent);
+    if (size <= 0) {
+      break;
+    }
+    frame_hdr_t hdr {
+      frame_kind_t::captured, static_cast<std::uint32_t>(idx),
+      static_cast<std::uint32_t>(size)
+    };
+    if (!try_write_fd(fd, reinterpret_cast<const char *>(&hdr), sizeof(hdr))
+        || !try_write_fd(fd, buf, static_cast<std::size_t>(size))) {
+      break;
+    }
+    capture_sent += size;
+  }  // for
+}
+
+// A stream buffer which a forked child uses in place of its report stream.
+// It sends what it holds to the parent whenever it fills or syncs, and when
+// the child dies of a fatal signal, so a fixture's report survives the
+// child's crash.  What the fixture wrote to standard output and error goes
+// first each time.
+class frame_buf_t final
+    : public std::streambuf {
+public:
+
+  frame_buf_t(int fd_, std::size_t idx_)
+      : fd(fd_), idx(idx_) {
+    setp(buf, buf + sizeof(buf));
+  }
+
+  virtual ~frame_buf_t();
+
+  // Sends what the buffer holds, if anything, without throwing, from a
+  // signal handler or as the child exits.
+  void send_quietly() noexcept {
+    send_captured(fd, idx);
+    auto size = static_cast<std::size_t>(pptr() - pbase());
+    if (size) {
+      frame_hdr_t hdr {
+        frame_kind_t::out, static_cast<std::uint32_t>(idx),
+        static_cast<std::uint32_t>(size)
+      };
+      try_write_fd(fd, reinterpret_cast<const char *>(&hdr), sizeof(hdr))
+          && try_write_fd(fd, pbase(), size);
+      setp(buf, buf + sizeof(buf));
+    }
+  }
+
+protected:
+
+  virtual int_type overflow(int_type c) override {
+    send();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  virtual int sync() override {
+    send();
+    return 0;
+  }
+
+private:
+
+  void send() {
+    send_captured(fd, idx);
+    auto size = static_cast<std::size_t>(pptr() - pbase());
+    if (size) {
+      write_frame(fd, frame_kind_t::out, idx, pbase(), size);
+      setp(buf, buf + sizeof(buf));
+    }
+  }
+
+  int fd;
+
+  std::size_t idx;
+
+  char buf[4096];
+
+};  // frame_buf_t
+
+frame_buf_t::~frame_buf_t() = default;
+
+// Waits while the futex holds the expected value, or until woken.
+static void wait_futex(std::atomic<int> &futex, int expected) noexcept {
+  syscall(
+      SYS_futex, reinterpret_cast<int *>(&futex), FUTEX_WAIT_PRIVATE,
+      expected, nullptr, nullptr, 0);
+}
+
+// Wakes up to the given number of threads waiting on the futex.
+static void wake_futex(std::atomic<int> &futex, int cnt) noexcept {
+  syscall(
+      SYS_futex, reinterpret_cast<int *>(&futex), FUTEX_WAKE_PRIVATE, cnt,
+      nullptr, nullptr, 0);
+}
+
+// Carries a run's output to a file descriptor without making the threads
+// which write it wait on write(2).  Each thread writes into a buffer of its
+// own, and hands the buffer, as a chunk, to a lock-free queue whenever it
+// flushes or the buffer grows large.  A writer thread takes everything in
+// the queue at once and writes it with as few calls to writev(2) as it can.
+// The chunks of each thread come out in the order in which they went in.
+//
+// Until start() and after stop(), a hand-off writes the chunk directly.  A
+// forking thread must drain() the pipeline first, and the child must call
+// on_fork(), as it has no writer thread.  When the process dies of a fatal
+// signal, on_fatal() writes whatever is left, as best it can.
+class out_pipe_t final {
+public:
+
+  explicit out_pipe_t(int fd_) noexcept
+      : fd(fd_), chunks(nullptr), locals(nullptr), sleeping(0), pushed(0),
+        written(0), drainer_cnt(0), busy(false), fatal(false),
+        stopping(false), has_writer(false) {}
+
+  out_pipe_t(const out_pipe_t &) = delete;
+
+  out_pipe_t &operator=(const out_pipe_t &) = delete;
+
+  // Appends to the calling thread's buffer.
+  void append(const char *data, std::size_t size) {
+    alloc_pause_t pause;
+    auto &local = get_local();
+    local.buf.append(data, size);
+    if (local.buf.size() >= max_local_size) {
+      hand_off(local);
+    }
+  }
+
+  // Hands the calling thread's buffer to the writer.
+  void hand_off() {
+    hand_off(get_local());
+  }
+
+  // Waits until everything handed off so far, including the calling
+  // thread's buffer, has been written.
+  void drain() {
+    hand_off();
+    if (!has_writer.load()) {
+      return;
+    }
+    auto target = pushed.load();
+    ++drainer_cnt;
+    for (;;) {
+      auto done = written.load();
+      if (static_cast<int>(
+              static_cast<unsigned>(done) - static_cast<unsigned>(target))
+          >= 0) {
+        break;
+      }
+      wait_futex(written, done);
+    }  // for
+    --drainer_cnt;
+  }
+
+  void start() {
+    stopping.store(false);
+    writer.reset(new std::thread { [this] { write_batches(); } });
+    has_writer.store(true);
+  }
+
+  // Writes everything handed off so far and stops the writer.
+  void stop() {
+    hand_off();
+    if (!has_writer.load()) {
+      return;
+    }
+    stopping.store(true);
+    if (sleeping.exchange(0)) {
+      wake_futex(sleeping, 1);
+    }
+    writer->join();
+    writer.reset();
+    has_writer.store(false);
+    /* A chunk handed off while the writer was stopping is still queued. */
+    write_chunks(take_chunks());
+  }
+
+  // Called in a forked child, which has a copy of the queue and the buffers
+  // but no writer.  The parent drained the queue before forking; what the
+  // other threads had buffered is the parent's to write, not the child's.
+  void on_fork() noexcept {
+    writer.release();
+    has_writer.store(false);
+    chunks.store(nullptr);
+    for (auto *local = locals.load(); local; local = local->next) {
+      local->buf.clear();
+    }  // for
+  }
+
+  // Writes whatever is queued or buffered, from a signal handler.  The
+  // threads' buffers go last, and the calling thread's buffer last of all,
+  // since those hold the latest output.
+  void on_fatal() noexcept {
+    if (fatal.exchange(true)) {
+      return;
+    }
+    /* Let the writer finish the batch in hand, if it isn't the writer which
+       is dying, but don't wait on it forever. */
+    if (has_writer.load() && !is_writer) {
+      for (int i = 0; busy.load() && i < 1000; ++i) {
+        timespec nap { 0, 1000000 };
+        nanosleep(&nap, nullptr);
+      }  // for
+    }
+    for (auto *chunk = take_chunks(); chunk; chunk = chunk->next) {
+      try_write_fd(fd, chunk->buf.data(), chunk->buf.size());
+    }  // for
+    for (auto *local = locals.load(); local; local = local->next) {
+      if (local != my_local) {
+        try_write_fd(fd, local->buf.data(), local->buf.size());
+      }
+    }  // for
+    if (my_local) {
+      try_write_fd(fd, my_local->buf.data(), my_local->buf.size());
+    }
+  }
+
+private:
+
+  // A buffer handed off to the writer, linked to the one handed off before
+  // it, or after it once the writer has put them in order.
+  struct chunk_t final {
+
+    chunk_t *next;
+
+    std::string buf;
+
+  };  // chunk_t
+
+  // A thread's buffer.  These are never freed; a thread takes over one
+  // which an earlier thread gave up, if there is one.
+  struct local_t final {
+
+    std::atomic<bool> taken;
+
+    std::string buf;
+
+    local_t *next;
+
+  };  // local_t
+
+  // Gives up the thread's buffer, handing off what's in it, when the thread
+  // exits.
+  class local_ref_t final {
+  public:
+
+    explicit local_ref_t(out_pipe_t &pipe_)
+        : pipe(pipe_), local(pipe_.take_local()) {
+      my_local = local;
+    }
+
+    local_ref_t(const local_ref_t &) = delete;
+
+    ~local_ref_t() {
+      pipe.hand_off(*local);
+      my_local = nullptr;
+      local->taken.store(false);
+    }
+
+    local_ref_t &operator=(const local_ref_t &) = delete;
+
+    local_t &get() const noexcept {
+      return *local;
+    }
+
+  private:
+
+    out_pipe_t &pipe;
+
+    local_t *local;
+
+  };  // local_ref_t
+
+  local_t &get_local() {
+    /* The plain pointer is what a signal handler reads. */
+    if (LICK_UNLIKELY(!my_local)) {
+      static thread_local local_ref_t ref { *this };
+      return ref.get();
+    }
+    return *my_local;
+  }
+
+  local_t *take_local() {
+    alloc_pause_t pause;
+    for (auto *local = locals.load(); local; local = local->next) {
+      bool was_taken = false;
+      if (local->taken.compare_exchange_strong(was_taken, true)) {
+        return local;
+      }
+    }  // for
+    auto *local = new local_t { { true }, {}, locals.load() };
+    while (!locals.compare_exchange_weak(local->next, local)) {}
+    return local;
+  }
+
+  void hand_off(local_t &local) {
+    if (local.buf.empty()) {
+      return;
+    }
+    alloc_pause_t pause;
+    if (!has_writer.load()) {
+      try_write_fd(fd, local.buf.data(), local.buf.size());
+      local.buf.clear();
+      return;
+    }
+    auto *chunk = new chunk_t { chunks.load(), std::move(local.buf) };
+    local.buf.clear();
+    ++pushed;
+    while (!chunks.compare_exchange_weak(chunk->next, chunk)) {}
+    if (sleeping.exchange(0)) {
+      wake_futex(sleeping, 1);
+    }
+  }
+
+  // Takes everything in the queue, oldest first.
+  chunk_t *take_chunks() noexcept {
+    chunk_t *in_order = nullptr;
+    for (auto *chunk = chunks.exchange(nullptr); chunk; ) {
+      auto *next = chunk->next;
+      chunk->next = in_order;
+      in_order = chunk;
+      chunk = next;
+    }  // for
+    return in_order;
+  }
+
+  // Writes and frees a list of chunks, returning how many there were.  If
+  // the file descriptor stops taking output, the rest is dropped.
+  int write_chunks(chunk_t *chunk) {
+    int cnt = 0;
+    bool ok = true;
+    while (chunk) {
+      iovec iovs[max_iov_cnt];
+      int iov_cnt = 0;
+      for (auto *next = chunk; next && iov_cnt < max_iov_cnt;
+          next = next->next) {
+        iovs[iov_cnt++] = iovec {
+          const_cast<char *>(next->buf.data()), next->buf.size()
+        };
+      }  // for
+      ok = ok && write_iovs(iovs, iov_cnt);
+      for (int i = 0; i < iov_cnt; ++i) {
+        auto *next = chunk->next;
+        delete chunk;
+        chunk = next;
+        ++cnt;
+      }  // for
+    }  // while
+    return cnt;
+  }
+
+  bool write_iovs(iovec *iovs, int iov_cnt) noexcept {
+    while (iov_cnt) {
+      auto actual = ::writev(fd, iovs, iov_cnt);
+      if (actual < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      auto left = static_cast<std::size_t>(actual);
+      while (iov_cnt && left >= iovs->iov_len) {
+        left -= iovs->iov_len;
+        ++iovs;
+        --iov_cnt;
+      }  // while
+      if (iov_cnt) {
+        iovs->iov_base = static_cast<char *>(iovs->iov_base) + left;
+        iovs->iov_len -= left;
+      }
+    }  // while
+    return true;
+  }
+
+  void write_batches() {
+    is_writer = true;
+    for (;;) {
+      busy.store(true);
+      if (fatal.load()) {
+        /* The signal handler writes what's left. */
+        busy.store(false);
+        return;
+      }
+      auto *chunk = take_chunks();
+      if (!chunk) {
+        busy.store(false);
+        if (stopping.load()) {
+          return;
+        }
+        sleeping.store(1);
+        if (chunks.load() || stopping.load()) {
+          sleeping.store(0);
+          continue;
+        }
+        wait_futex(sleeping, 1);
+        /* Give the threads which woke the writer a moment to hand off more,
+           so that the next write takes many chunks at once, unless someone
+           is waiting. */
+        if (!drainer_cnt.load() && !stopping.load()) {
+          timespec nap { 0, batch_window_ns };
+          nanosleep(&nap, nullptr);
+        }
+        continue;
+      }
+      auto cnt = write_chunks(chunk);
+      busy.store(false);
+      written += cnt;
+      if (drainer_cnt.load()) {
+        wake_futex(written, std::numeric_limits<int>::max());
+      }
+    }  // for
+  }
+
+  static constexpr std::size_t max_local_size = 65536;
+
+  static constexpr int max_iov_cnt = 1024;
+
+  static constexpr long batch_window_ns = 1000000;
+
+  int fd;
+
+  // The queue, newest first.
+  std::atomic<chunk_t *> chunks;
+
+  std::atomic<local_t *> locals;
+
+  // Futexes: 1 while the writer sleeps, and the number of chunks handed off
+  // and written, which wrap.
+  std::atomic<int> sleeping, pushed, written;
+
+  std::atomic<int> drainer_cnt;
+
+  // True while the writer holds chunks it took from the queue.
+  std::atomic<bool> busy;
+
+  std::atomic<bool> fatal, stopping, has_writer;
+
+  std::unique_ptr<std::thread> writer;
+
+  static thread_local local_t *my_local;
+
+  static thread_local bool is_writer;
+
+};  // out_pipe_t
+
+thread_local out_pipe_t::local_t *out_pipe_t::my_local = nullptr;
+
+thread_local bool out_pipe_t::is_writer = false;
+
+// The pipeline to standard output, which std::cout feeds while fixtures run.
+static out_pipe_t out_pipe { STDOUT_FILENO };
+
+// A stream buffer which feeds out_pipe.  It keeps no buffer of its own, as
+// out_pipe keeps one per thread, so any number of threads may write to it
+// at once.  Syncing it hands off the calling thread's buffer.
+class out_buf_t final
+    : public std::streambuf {
+public:
+
+  out_buf_t() = default;
+
+  virtual ~out_buf_t();
+
+protected:
+
+  virtual int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      char ch = traits_type::to_char_type(c);
+      out_pipe.append(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  virtual std::streamsize xsputn(const char *data, std::streamsize size)
+      override {
+    out_pipe.append(data, static_cast<std::size_t>(size));
+    return size;
+  }
+
+  virtual int sync() override {
+    out_pipe.hand_off();
+    return 0;
+  }
+
+};  // out_buf_t
+
+out_buf_t::~out_buf_t() = default;
+
+static out_buf_t out_buf;
+
+// The frame buffer of the fixture a forked child is running, if any.
+static frame_buf_t *running_frame_buf = nullptr;
+
+// The signals on which pending output is written before the process dies.
+static const int fatal_sigs[] = {
+  SIGABRT, SIGBUS, SIGFPE, SIGILL, SIGINT, SIGSEGV, SIGTERM
+};
+
+static constexpr std::size_t fatal_sig_cnt =
+    sizeof(fatal_sigs) / sizeof(fatal_sigs[0]);
+
+// The actions which the handler below displaced, one per fatal signal.
+static struct sigaction old_fatal_actions[fatal_sig_cnt];
+
+// Writes what's pending before the process dies of a fatal signal, then
+// puts back the action it displaced, such as a sanitizer's or the program's
+// own handler, and lets the signal take that course.
+static void on_fatal_signal(int sig) {
+  /* In a child, what's pending for standard output goes to the capture
+     file, and from there into the fixture's report. */
+  out_pipe.on_fatal();
+  if (running_frame_buf) {
+    running_frame_buf->send_quietly();
+  }
+  for (std::size_t i = 0; i < fatal_sig_cnt; ++i) {
+    if (fatal_sigs[i] == sig) {
+      sigaction(sig, &old_fatal_actions[i], nullptr);
+      break;
+    }
+  }  // for
+  raise(sig);
+}
+
+// Sends std::cout through out_pipe, if that's where the report goes, and
+// writes pending output on fatal signals, for the lifetime of a run.
+class out_session_t final {
+public:
+
+  explicit out_session_t(const cfg_t &cfg)
+      : old_buf(nullptr) {
+    /* The handler needs a stack of its own to report a stack overflow. */
+    alt_stack.resize(std::max<std::size_t>(SIGSTKSZ, 65536));
+    stack_t stack {};
+    stack.ss_sp = &alt_stack[0];
+    stack.ss_size = alt_stack.size();
+    sigaltstack(&stack, &old_stack);
+    struct sigaction action {};
+    action.sa_handler = on_fatal_signal;
+    action.sa_flags = SA_RESETHAND | SA_NODEFER | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (std::size_t i = 0; i < fatal_sig_cnt; ++i) {
+      sigaction(fatal_sigs[i], &action, &old_fatal_actions[i]);
+    }  // for
+    if (&cfg.get_strm() == &std::cout) {
+      std::cout.flush();
+      out_pipe.start();
+      old_buf = std::cout.rdbuf(&out_buf);
+    }
+    live = this;
+    /* A fixture may call exit(). */
+    if (!has_exit_hook) {
+      std::atexit(on_exit);
+      has_exit_hook = true;
+    }
+  }
+
+  out_session_t(const out_session_t &) = delete;
+
+  ~out_session_t() {
+    stop();
+    for (std::size_t i = 0; i < fatal_sig_cnt; ++i) {
+      sigaction(fatal_sigs[i], &old_fatal_actions[i], nullptr);
+    }  // for
+    sigaltstack(&old_stack, nullptr);
+  }
+
+  out_session_t &operator=(const out_session_t &) = delete;
+
+private:
+
+  void stop() {
+    if (old_buf) {
+      out_pipe.stop();
+      std::cout.rdbuf(old_buf);
+      old_buf = nullptr;
+    }
+    live = nullptr;
+  }
+
+  static void on_exit() {
+    if (running_frame_buf) {
+      running_frame_buf->send_quietly();
+    }
+    if (live) {
+      live->stop();
+    }
+  }
+
+  std::streambuf *old_buf;
+
+  std::vector<char> alt_stack;
+
+  stack_t old_stack;
+
+  static out_session_t *live;
+
+  static bool has_exit_hook;
+
+};  // out_session_t
+
+out_session_t *out_session_t::live = nullptr;
+
+bool out_session_t::has_exit_hook = false;
+
+// Serializes outcomes for the trip from a forked child to its parent.  Since
+// the child is a fork of the parent, the file names in the notes' locations
+// point to the same string literals in both, so they travel as pointers.
+
+template <typename val_t>
+static void put_pod(std::string &buf, const val_t &val) {
+  buf.append(reinterpret_cast<const char *>(&val), sizeof(val));
+}
+
+template <typename val_t>
+static val_t get_pod(const char *&cursor) {
+  val_t val;
+  std::memcpy(&val, cursor, sizeof(val));
+  cursor += sizeof(val);
+  return val;
+}
+
+static void put_str(std::string &buf, const std::string &str) {
+  put_pod(buf, str.size());
+  buf.append(str);
+}
+
+static std::string get_str(const char *&cursor) {
+  auto size = get_pod<std::size_t>(cursor);
+  std::string str { cursor, size };
+  cursor += size;
+  return str;
+}
+
+static std::string put_outcome(const outcome_t &outcome) {
+  std::string buf;
+  put_pod(buf, outcome.ok);
+  put_pod(buf, outcome.wall);
+  put_pod(buf, outcome.cpu);
+  put_pod(buf, outcome.allocs);
+  put_pod(buf, outcome.counters);
+  put_pod(buf, outcome.samples.size());
+  for (double sample : outcome.samples) {
+    put_pod(buf, sample);
+  }
+  put_pod(buf, outcome.notes.size());
+  for (const auto &note : outcome.notes) {
+    put_pod(buf, note.kind);
+    put_pod(buf, note.loc.get_file());
+    put_pod(buf, note.loc.get_line());
+    put_pod(buf, note.ok);
+    put_str(buf, note.msg);
+  }
+  return buf;
+}
+
+static outcome_t get_outcome(const char *cursor) {
+  outcome_t outcome;
+  outcome.ok = get_pod<bool>(cursor);
+  outcome.wall = get_pod<double>(cursor);
+  outcome.cpu = get_pod<double>(cursor);
+  outcome.allocs = get_pod<allocs_t>(cursor);
+  outcome.counters = get_pod<counters_t>(cursor);
+  outcome.samples.resize(get_pod<std::size_t>(cursor));
+  for (auto &sample : outcome.samples) {
+    sample = get_pod<double>(cursor);
+  }
+  auto note_cnt = get_pod<std::size_t>(cursor);
+  for (std::size_t i = 0; i < note_cnt; ++i) {
+    auto kind = get_pod<const char *>(cursor);
+    auto file = get_pod<const char *>(cursor);
+    loc_t loc { file, get_pod<int>(cursor) };
+    auto ok = get_pod<bool>(cursor);
+    outcome.notes.push_back(note_t { kind, loc, ok, get_str(cursor) });
+  }
+  return outcome;
+}
+
+std::string get_status_msg(int status) {
+  std::ostringstream strm;
+  if (WIFSIGNALED(status)) {
+    int sig = WTERMSIG(status);
+    strm << "killed by signal " << sig << " (" << strsignal(sig) << ')';
+  } else {
+    strm << "exited with status " << WEXITSTATUS(status);
+  }
+  return strm.str();
+}
+
+// The parent's view of a forked child working through a batch of fixtures.
+struct child_t final {
+
+  pid_t pid;
+
+  // The read end of the child's pipe.
+  int fd;
+
+  // The fixtures the child has yet to begin.
+  std::deque<std::size_t> batch;
+
+  // True while the child is between the begin and end frames of a fixture.
+  bool busy;
+
+  // The fixture in progress, if the child is busy, and the wall-clock time
+  // at which the parent heard it begin.
+  std::size_t idx;
+
+  double begin_time;
+
+  // True if the parent stopped the child for running too long, first with
+  // SIGTERM, so that the child can send what it has of its report, and
+  // then, if it lingers, with SIGKILL.
+  bool timed_out, killed;
+
+  // Bytes read from the pipe but not yet parsed into frames.
+  std::string pending;
+
+  // The report so far of the fixture in progress, with what it wrote to
+  // standard output and error.
+  std::string report;
+
+  // True once the fixture in progress has sent any of lick's own report,
+  // which begins with the line naming the fixture.
+  bool reported;
+
+};  // child_t
+
+// Runs a batch of fixtures in a forked child, then exits it.
+[[noreturn]] static void run_child(
+    int fd, const cfg_t &cfg, const std::vector<const fixture_t *> &fixtures,
+    const std::deque<std::size_t> &batch) {
+  perf.close_all();
+  out_pipe.on_fork();
+  /* What the fixtures write to standard output and error goes to a file,
+     and from there into the report of the fixture running at the time.  A
+     file rather than a pipe, so that a fixture which writes a lot never
+     waits on the child to read it. */
+  int out_fd = dup(STDOUT_FILENO);
+  capture_fd = memfd_create("lick-capture", MFD_CLOEXEC);
+  if (capture_fd >= 0 && out_fd >= 0) {
+    dup2(capture_fd, STDOUT_FILENO);
+    dup2(capture_fd, STDERR_FILENO);
+  } else if (capture_fd >= 0) {
+    close(capture_fd);
+    capture_fd = -1;
+  }
+  auto flush_std = [] {
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(stdout);
+    std::fflush(stderr);
+  };
+  auto stalled = stall(
+    [&] {
+      for (auto idx : batch) {
+        write_frame(fd, frame_kind_t::begin, idx);
+        frame_buf_t buf { fd, idx };
+        running_frame_buf = &buf;
+        std::ostream strm { &buf };
+        auto outcome = put_outcome(fixtures[idx]->run(cfg, strm));
+        flush_std();
+        strm.flush();
+        running_frame_buf = nullptr;
+        write_frame(
+            fd, frame_kind_t::end, idx, outcome.data(), outcome.size());
+      }
+    }
+  );
+  flush_std();
+  /* Whatever was written after the last fixture goes where it would have
+     gone had it not been captured. */
+  if (capture_fd >= 0) {
+    char buf[4096];
+    ssize_t size;
+    while ((size = pread(capture_fd, buf, sizeof(buf), capture_sent)) > 0) {
+      try_write_fd(out_fd, buf, static_cast<std::size_t>(size));
+      capture_sent += size;
+    }  // while
+  }
+  _exit(stalled ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+// The event loop on which coroutine fixtures await timers and file
+// descriptors.  It resumes each coroutine in the context of the fixture which
+// suspended it, so that what the coroutine expects reports to its fixture.
+// A loop is the calling thread's for its lifetime.
+class loop_t final {
+public:
+
+  using resume_t = void (*)(void *);
+
+  // Watches each resumption, if given a watchdog, so that a fixture which
+  // blocks the loop can't stall the others forever.
+  explicit loop_t(watchdog_t *watchdog_)
+      : watchdog(watchdog_), epoll_fd(epoll_create1(EPOLL_CLOEXEC)),
+        host(current) {
+    if (epoll_fd < 0) {
+      throw std::system_error { errno, std::system_category(), "epoll" };
+    }
+    current = this;
+  }
+
+  loop_t(const loop_t &) = delete;
+
+  ~loop_t() {
+    current = host;
+    close(epoll_fd);
+  }
+
+  loop_t &operator=(const loop_t &) = delete;
+
+  // Resumes the coroutine at the next poll.
+  void add_ready(resume_t resume, void *addr, ctxt_t *ctxt) {
+    ready.push_back(waiter_t { resume, addr, ctxt });
+  }
+
+  void add_timer(double secs, resume_t resume, void *addr, ctxt_t *ctxt) {
+    timers.emplace(
+        get_wall_time() + std::max(secs, 0.0),
+        waiter_t { resume, addr, ctxt });
+  }
+
+  void add_fd(
+      int fd, bool writing, resume_t resume, void *addr, ctxt_t *ctxt) {
+    if (fd_waiters.count(fd)) {
+      throw std::logic_error { "another coroutine awaits the same fd" };
+    }
+    epoll_event event {};
+    event.events = writing ? EPOLLOUT : EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      /* Epoll refuses regular files and directories, which are always
+         ready. */
+      if (errno != EPERM) {
+        throw std::system_error {
+          errno, std::system_category(), "epoll_ctl"
+        };
+      }
+      add_ready(resume, addr, ctxt);
+      return;
+    }
+    fd_waiters[fd] = waiter_t { resume, addr, ctxt };
+  }
+
+  // Forgets whatever the coroutines of the given context await, as when they
+  // are about to be destroyed.
+  void cancel(const ctxt_t *ctxt) {
+    ready.erase(
+        std::remove_if(
+            ready.begin(), ready.end(),
+            [&](const waiter_t &waiter) { return waiter.ctxt == ctxt; }),
+        ready.end());
+    for (auto iter = timers.begin(); iter != timers.end(); ) {
+      iter = (iter->second.ctxt == ctxt) ? timers.erase(iter) : ++iter;
+    }  // for
+    for (auto iter = fd_waiters.begin(); iter != fd_waiters.end(); ) {
+      if (iter->second.ctxt == ctxt) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, iter->first, nullptr);
+        iter = fd_waiters.erase(iter);
+      } else {
+        ++iter;
+      }
+    }  // for
+  }
+
+  // True if nothing awaits the loop, in which case polling would wait for
+  // nothing.
+  bool is_idle() const noexcept {
+    return ready.empty() && timers.empty() && fd_waiters.empty();
+  }
+
+  // Waits until something is ready or the given wall time, whichever comes
+  // first, then resumes whatever is ready.
+  void poll(double deadline) {
+    auto now = get_wall_time();
+    if (!timers.empty()) {
+      deadline = std::min(deadline, timers.begin()->first);
+    }
+    /* Epoll counts in whole milliseconds, so the wait rounds up rather than
+       waking early and spinning. */
+    int wait_ms = !ready.empty()
+        ? 0
+        : std::isinf(deadline)
+        ? -1
+        : static_cast<int>(std::min(
+            std::ceil(std::max(deadline - now, 0.0) * 1000), 1e9));
+    epoll_event events[max_event_cnt];
+    auto event_cnt = epoll_wait(epoll_fd, events, max_event_cnt, wait_ms);
+    if (event_cnt < 0) {
+      if (errno != EINTR) {
+        throw std::system_error {
+          errno, std::system_category(), "epoll_wait"
+        };
+      }
+      event_cnt = 0;
+    }
+    std::vector<waiter_t> due;
+    due.swap(ready);
+    for (int i = 0; i < event_cnt; ++i) {
+      auto iter = fd_waiters.find(events[i].data.fd);
+      if (iter != fd_waiters.end()) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, iter->first, nullptr);
+        due.push_back(iter->second);
+        fd_waiters.erase(iter);
+      }
+    }  // for
+    now = get_wall_time();
+    while (!timers.empty() && timers.begin()->first <= now) {
+      due.push_back(timers.begin()->second);
+      timers.erase(timers.begin());
+    }  // while
+    for (const auto &waiter : due) {
+      resume(waiter);
+    }  // for
+  }
+
+  // The calling thread's loop, or null if it has none.
+  static loop_t *get_current() noexcept {
+    return current;
+  }
+
+private:
+
+  struct waiter_t final {
+
+    resume_t resume;
+
+    void *addr;
+
+    // The context of the fixture whose coroutine this is.
+    ctxt_t *ctxt;
+
+  };  // waiter_t
+
+  void resume(const waiter_t &waiter) {
+    if (!waiter.ctxt) {
+      waiter.resume(waiter.addr);
+      return;
+    }
+    ctxt_t::guest_t guest { *waiter.ctxt };
+    const auto *fixture = waiter.ctxt->get_fixture();
+    if (watchdog && fixture) {
+      watchdog_t::watch_t watch { *watchdog, *fixture };
+      waiter.resume(waiter.addr);
+    } else {
+      waiter.resume(waiter.addr);
+    }
+  }
+
+  static constexpr int max_event_cnt = 64;
+
+  watchdog_t *watchdog;
+
+  int epoll_fd;
+
+  // Resumed at the next poll without waiting.
+  std::vector<waiter_t> ready;
+
+  // By the wall time at which they're due.
+  std::multimap<double, waiter_t> timers;
+
+  // By descriptor.
+  std::unordered_map<int, waiter_t> fd_waiters;
+
+  // The loop, if any, which this one displaced as the thread's.
+  loop_t *host;
+
+  static thread_local loop_t *current;
+
+};  // loop_t
+
+thread_local loop_t *loop_t::current = nullptr;
+
+// The running loop, or throws if there is none.
+static loop_t &get_loop() {
+  auto *loop = loop_t::get_current();
+  if (!loop) {
+    throw std::logic_error {
+      "lick's loop can be awaited only within an ASYNC_FIXTURE"
+    };
+  }
+  return *loop;
+}
+
+void await_timer(double secs, void (*resume)(void *), void *addr) {
+  get_loop().add_timer(secs, resume, addr, ctxt_t::get_singleton());
+}
+
+void await_fd(int fd, bool writing, void (*resume)(void *), void *addr) {
+  get_loop().add_fd(fd, writing, resume, addr, ctxt_t::get_singleton());
+}
 
-fixture_t::fixture_t(const loc_t &loc_, const char *name_, fn_t fn_)
-    : loc(loc_), name(name_), fn(fn_), next(nullptr) {
-  (last ? last->next : first) = this;
-  last = this;
+// Throws on behalf of a coroutine which is suspended, but not on the loop, so
+// that nothing will ever resume it.
+[[noreturn]] static void throw_stranded() {
+  throw std::logic_error { "suspended awaiting something other than lick" };
 }
 
-bool fixture_t::operator()(const cfg_t &cfg) const {
-  ctxt_t ctxt { this, cfg };
-  auto stalled = stall(fn);
-  if (!stalled) {
-    cfg.get_strm()
-        << indent_t { 1 }
-        << red << "exception" << plain << separator
-        << stalled.msg << std::endl;
-    return false;
+// Runs a coroutine fixture on a loop of its own, as when it runs in a child
+// rather than with the others.
+void fixture_t::run_async(ctxt_t &ctxt) const {
+  loop_t loop { nullptr };
+  auto *addr = async->start();
+  loop.add_ready(async->resume, addr, &ctxt);
+  while (!async->is_done(addr) && !loop.is_idle()) {
+    loop.poll(std::numeric_limits<double>::infinity());
+  }  // while
+  if (!async->is_done(addr)) {
+    async->destroy(addr);
+    throw_stranded();
   }
-  return ctxt;
+  async->finish(addr);
 }
 
-bool fixture_t::for_each(const cb_t &cb) {
-  for (auto *fixture = first; fixture; fixture = fixture->next) {
-    if (!cb(*fixture)) {
-      return false;
+// Runs the coroutine fixtures at the given indices of a slate interleaved on
+// one loop, at most max_live_cnt at a time, and finishes each.  Each reports
+// to a string of its own, which goes to 'reports' at its index.  The loop
+// enforces timeouts itself, by destroying a coroutine which runs too long,
+// since a suspended coroutine can be stopped safely.
+static void run_on_loop(
+    slate_t &slate, const std::vector<std::size_t> &idxs,
+    std::vector<std::string> &reports) {
+  static constexpr std::size_t max_live_cnt = 256;
+  struct live_t final {
+
+    live_t(std::size_t idx_, const cfg_t &cfg, const fixture_t &fixture)
+        : idx(idx_), async(*fixture.get_async()),
+          ctxt(new ctxt_t { &fixture, cfg, report }), addr(nullptr) {
+      auto timeout = fixture.get_timeout(cfg);
+      deadline = (timeout > 0)
+          ? get_wall_time() + timeout
+          : std::numeric_limits<double>::infinity();
     }
-  }  // for
-  return true;
-}
 
-fixture_t
-    *fixture_t::first = nullptr,
-    *fixture_t::last = nullptr;
+    std::size_t idx;
 
-any_operand_t::~any_operand_t() = default;
+    const async_fixture_t &async;
 
-predicate_t::~predicate_t() = default;
+    std::ostringstream report;
 
-void predicate_t::write_src(std::ostream &strm) const {
-  const char *name = get_name();
-  strm << "EXPECT";
-  if (*name) {
-    strm << '_' << name;
-  }
-  strm << '(';
-  bool needs_comma = false;
-  for_each_operand(
-    [&](const any_operand_t &operand) {
-      if (needs_comma) {
-        strm << ", ";
-      } else {
-        needs_comma = true;
+    std::unique_ptr<ctxt_t> ctxt;
+
+    // Null if the coroutine couldn't be made.
+    void *addr;
+
+    double deadline;
+
+  };  // live_t
+  const auto &cfg = slate.cfg;
+  watchdog_t watchdog { slate };
+  loop_t loop { &watchdog };
+  std::list<live_t> lives;
+  auto end = [&](std::list<live_t>::iterator iter, outcome_t outcome) {
+    const auto &fixture = *slate.fixtures[iter->idx];
+    iter->ctxt.reset();
+    drop_resource_users(fixture);
+    reports[iter->idx] = iter->report.str();
+    slate.finish(iter->idx, std::move(outcome));
+    lives.erase(iter);
+  };
+  std::size_t next = 0;
+  while (next < idxs.size() || !lives.empty()) {
+    for (; next < idxs.size() && lives.size() < max_live_cnt; ++next) {
+      auto idx = idxs[next];
+      const auto &fixture = *slate.fixtures[idx];
+      lives.emplace_back(idx, cfg, fixture);
+      auto &live = lives.back();
+      auto started = stall([&] { live.addr = live.async.start(); });
+      if (!started) {
+        end(std::prev(lives.end()), fixture.conclude(*live.ctxt, started));
+        continue;
       }
-      strm << src_of(operand);
-      return true;
+      loop.add_ready(live.async.resume, live.addr, live.ctxt.get());
+    }  // for
+    auto deadline = std::numeric_limits<double>::infinity();
+    for (const auto &live : lives) {
+      deadline = std::min(deadline, live.deadline);
+    }  // for
+    bool was_idle = loop.is_idle();
+    if (!was_idle) {
+      loop.poll(deadline);
     }
-  );
-  strm << ')';
+    auto now = get_wall_time();
+    for (auto iter = lives.begin(); iter != lives.end(); ) {
+      auto &live = *iter++;
+      const auto &fixture = *live.ctxt->get_fixture();
+      auto live_iter = std::prev(iter);
+      if (live.async.is_done(live.addr)) {
+        auto stalled = stall(
+          [&] {
+            ctxt_t::guest_t guest { *live.ctxt };
+            live.async.finish(live.addr);
+          }
+        );
+        end(live_iter, fixture.conclude(*live.ctxt, stalled));
+        continue;
+      }
+      if (now < live.deadline && !was_idle) {
+        continue;
+      }
+      /* The fixture ran out of time, or nothing is left on the loop which
+         could resume it. */
+      loop.cancel(live.ctxt.get());
+      {
+        ctxt_t::guest_t guest { *live.ctxt };
+        live.async.destroy(live.addr);
+      }
+      if (was_idle) {
+        end(live_iter, fixture.conclude(*live.ctxt, stall(throw_stranded)));
+        continue;
+      }
+      std::ostringstream msg;
+      msg << "ran longer than " << dur_t { fixture.get_timeout(cfg) };
+      note_t note { "timeout", fixture.get_loc(), false, msg.str() };
+      live.ctxt->get_strm()
+          << indent_t { 1 }
+          << red << note.kind << plain << separator
+          << note.msg << '\n';
+      live.ctxt->add_note(std::move(note));
+      end(live_iter, live.ctxt->stop());
+    }  // for
+  }  // while
 }
 
-bool unary_t::for_each_operand(const cb_t &cb) const {
-  return cb(operand);
-}
+// Each of the following runs the fixtures on a slate, finishing and
+// publishing each in turn.
 
-bool binary_t::for_each_operand(const cb_t &cb) const {
-  return cb(lhs) && cb(rhs);
+static void run_serially(slate_t &slate) {
+  const auto &cfg = slate.cfg;
+  watchdog_t watchdog { slate };
+  /* The coroutine fixtures all run together on the loop when the first of
+     them comes up, and their reports then wait their turns. */
+  std::vector<std::size_t> async_idxs;
+  for (std::size_t idx = 0; idx < slate.size(); ++idx) {
+    if (slate.fixtures[idx]->get_async()) {
+      async_idxs.push_back(idx);
+    }
+  }  // for
+  std::vector<std::string> async_reports;
+  for (std::size_t idx = 0; idx < slate.size(); ++idx) {
+    const auto &fixture = *slate.fixtures[idx];
+    if (fixture.get_async()) {
+      if (async_reports.empty()) {
+        async_reports.resize(slate.size());
+        run_on_loop(slate, async_idxs, async_reports);
+      }
+      cfg.get_strm() << async_reports[idx] << std::flush;
+      async_reports[idx] = std::string {};
+    } else {
+      watchdog_t::watch_t watch { watchdog, fixture };
+      slate.finish(idx, fixture.run(cfg, cfg.get_strm()));
+    }
+    slate.publish(idx);
+  }  // for
 }
 
-bool ternary_t::for_each_operand(const cb_t &cb) const {
-  return cb(lhs) && cb(rhs) && cb(coef);
+static void run_on_threads(slate_t &slate) {
+  const auto &cfg = slate.cfg;
+  auto &strm = cfg.get_strm();
+  watchdog_t watchdog { slate };
+  board_t board { slate.size() };
+  /* The coroutine fixtures all run together on the loop, on whichever worker
+     first comes to one of them, while the other workers carry on with the
+     rest.  The others of them then cost their workers nothing. */
+  std::vector<std::size_t> async_idxs;
+  for (std::size_t idx = 0; idx < slate.size(); ++idx) {
+    if (slate.fixtures[idx]->get_async()) {
+      async_idxs.push_back(idx);
+    }
+  }  // for
+  std::atomic_flag async_claimed = ATOMIC_FLAG_INIT;
+  pool_t pool {
+    cfg.get_jobs(), slate.size(),
+    [&](std::size_t idx) {
+      const auto &fixture = *slate.fixtures[idx];
+      if (fixture.get_async()) {
+        if (async_claimed.test_and_set()) {
+          return;
+        }
+        std::vector<std::string> reports(slate.size());
+        run_on_loop(slate, async_idxs, reports);
+        for (auto async_idx : async_idxs) {
+          board.post(async_idx, std::move(reports[async_idx]));
+        }  // for
+        return;
+      }
+      watchdog_t::watch_t watch { watchdog, fixture };
+      std::ostringstream report;
+      slate.finish(idx, fixture.run(cfg, report));
+      board.post(idx, report.str());
+    }
+  };
+  for (std::size_t idx = 0; idx < slate.size(); ++idx) {
+    strm << board.take(idx) << std::flush;
+    slate.publish(idx);
+  }
 }
 
-namespace predicate {
-
-const char *true_t::get_name() const {
-  return "";
+// Runs batches of fixtures in forked children, up to one child per job at a
+// time.  If a child dies in the middle of a fixture, that fixture fails with
+// whatever report it had sent so far and the rest of its batch goes to a new
+// child.  The parent enforces timeouts by killing the child.
+static void run_in_forks(slate_t &slate) {
+  /* The seconds a child stopped for running too long has to die. */
+  static const double term_grace = 1;
+  const auto &cfg = slate.cfg;
+  const auto &fixtures = slate.fixtures;
+  auto &strm = cfg.get_strm();
+  std::deque<std::deque<std::size_t>> batches;
+  auto batch_size = static_cast<std::size_t>(cfg.get_fork_batch());
+  for (std::size_t idx = 0; idx < fixtures.size(); ++idx) {
+    if (idx % batch_size == 0) {
+      batches.emplace_back();
+    }
+    batches.back().push_back(idx);
+  }
+  std::vector<std::string> reports(fixtures.size());
+  std::vector<bool> done(fixtures.size(), false);
+  std::size_t next_idx = 0;
+  auto finish = [&](std::size_t idx, outcome_t outcome, std::string report) {
+    slate.finish(idx, std::move(outcome));
+    reports[idx] = std::move(report);
+    done[idx] = true;
+    for (; next_idx < done.size() && done[next_idx]; ++next_idx) {
+      strm << reports[next_idx] << std::flush;
+      reports[next_idx].clear();
+      slate.publish(next_idx);
+    }
+  };
+  std::vector<child_t> children;
+  while (!batches.empty() || !children.empty()) {
+    while (!batches.empty()
+        && children.size() < static_cast<std::size_t>(cfg.get_jobs())) {
+      int fds[2];
+      if (pipe(fds) < 0) {
+        throw std::system_error { errno, std::system_category(), "pipe" };
+      }
+      strm.flush();
+      std::cout.flush();
+      out_pipe.drain();
+      std::cerr.flush();
+      auto pid = fork();
+      if (pid < 0) {
+        throw std::system_error { errno, std::system_category(), "fork" };
+      }
+      if (pid == 0) {
+        close(fds[0]);
+        run_child(fds[1], cfg, fixtures, batches.front());
+      }
+      close(fds[1]);
+      children.push_back(
+          child_t {
+            pid, fds[0], std::move(batches.front()), false, 0, 0, false,
+            false, {}, {}, false
+          });
+      batches.pop_front();
+    }
+    std::vector<pollfd> pollfds;
+    double wait = -1;
+    for (auto &child : children) {
+      pollfds.push_back(pollfd { child.fd, POLLIN, 0 });
+      double timeout = child.busy
+          ? fixtures[child.idx]->get_timeout(cfg) : 0;
+      if (timeout > 0 && !child.killed) {
+        double left = child.begin_time + timeout - get_wall_time();
+        if (child.timed_out) {
+          left += term_grace;
+        }
+        if (left > 0) {
+          if (wait < 0 || left < wait) {
+            wait = left;
+          }
+        } else if (!child.timed_out) {
+          kill(child.pid, SIGTERM);
+          child.timed_out = true;
+          if (wait < 0 || term_grace < wait) {
+            wait = term_grace;
+          }
+        } else {
+          kill(child.pid, SIGKILL);
+          child.killed = true;
+        }
+      }
+    }  // for
+    int wait_ms = (wait < 0) ? -1 : static_cast<int>(std::ceil(wait * 1000));
+    if (poll(pollfds.data(), pollfds.size(), wait_ms) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error { errno, std::system_category(), "poll" };
+    }
+    for (std::size_t i = children.size(); i-- > 0;) {
+      if (!pollfds[i].revents) {
+        continue;
+      }
+      auto &child = children[i];
+      char buf[65536];
+      auto actual = ::read(child.fd, buf, sizeof(buf));
+      if (actual < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::system_error { errno, std::system_category(), "read" };
+      }
+      if (actual > 0) {
+        child.pending.append(buf, static_cast<std::size_t>(actual));
+        while (child.pending.size() >= sizeof(frame_hdr_t)) {
+          frame_hdr_t hdr;
+          std::memcpy(&hdr, child.pending.data(), sizeof(hdr));
+          if (child.pending.size() < sizeof(hdr) + hdr.size) {
+            break;
+          }
+          const char *payload = child.pending.data() + sizeof(hdr);
+          switch (hdr.kind) {
+            case frame_kind_t::begin: {
+              child.batch.pop_front();
+              child.busy = true;
+              child.idx = hdr.idx;
+              child.begin_time = get_wall_time();
+              child.reported = false;
+              break;
+            }
+            case frame_kind_t::out: {
+              child.report.append(payload, hdr.size);
+              child.reported = true;
+              break;
+            }
+            case frame_kind_t::captured: {
+              child.report.append(payload, hdr.size);
+              break;
+            }
+            case frame_kind_t::end: {
+              child.busy = false;
+              finish(
+                  hdr.idx, get_outcome(payload), std::move(child.report));
+              child.report.clear();
+              child.reported = false;
+              break;
+            }
+          }
+          child.pending.erase(0, sizeof(hdr) + hdr.size);
+        }  // while
+        continue;
+      }
+      close(child.fd);
+      int status;
+      while (waitpid(child.pid, &status, 0) < 0 && errno == EINTR);
+      if (child.busy || !child.batch.empty()) {
+        /* The child died early.  Blame the fixture it was running, or, if it
+           died between fixtures, the next one it would have run.  Whatever
+           is left of its batch goes to a new child. */
+        auto idx = child.idx;
+        outcome_t outcome { false, 0, 0, {}, {}, {}, {} };
+        if (child.busy) {
+          outcome.wall = get_wall_time() - child.begin_time;
+        } else {
+          idx = child.batch.front();
+          child.batch.pop_front();
+        }
+        std::ostringstream report;
+        if (!child.reported) {
+          write_begin(report, *fixtures[idx]);
+        }
+        note_t note { "crash", fixtures[idx]->get_loc(), false, {} };
+        if (child.timed_out) {
+          std::ostringstream msg;
+          msg
+              << "ran longer than "
+              << dur_t { fixtures[idx]->get_timeout(cfg) };
+          note.kind = "timeout";
+          note.msg = msg.str();
+        } else {
+          note.msg = get_status_msg(status);
+        }
+        report
+            << child.report << indent_t { 1 }
+            << red << note.kind << plain << separator
+            << note.msg << '\n';
+        outcome.notes.push_back(std::move(note));
+        write_end(
+            report, *fixtures[idx], outcome, cfg.get_verbosity() >= 2,
+            cfg.tracks_allocs());
+        finish(idx, std::move(outcome), report.str());
+        if (!child.batch.empty()) {
+          batches.push_front(std::move(child.batch));
+        }
+      }
+      children.erase(children.begin() + static_cast<std::ptrdiff_t>(i));
+    }  // for
+  }  // while
 }
 
-const char *false_t::get_name() const {
-  return "NOT";
+// Identifies the build of this program: the linker's GNU build ID, if it
+// left one, or else a hash of the executable's contents.  Returns an empty
+// string if neither is to be had.
+static std::string get_build_id() {
+  std::string build_id;
+  dl_iterate_phdr(
+    [](dl_phdr_info *info, std::size_t, void *data) {
+      /* The first object is the executable itself. */
+      auto &build_id = *static_cast<std::string *>(data);
+      for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+        const auto &phdr = info->dlpi_phdr[i];
+        if (phdr.p_type != PT_NOTE) {
+          continue;
+        }
+        auto cursor = reinterpret_cast<const char *>(
+            info->dlpi_addr + phdr.p_vaddr);
+        auto end = cursor + phdr.p_memsz;
+        while (cursor + sizeof(ElfW(Nhdr)) <= end) {
+          ElfW(Nhdr) nhdr;
+          std::memcpy(&nhdr, cursor, sizeof(nhdr));
+          auto name = cursor + sizeof(nhdr);
+          auto desc = name + ((nhdr.n_namesz + 3) & ~3u);
+          if (nhdr.n_type == NT_GNU_BUILD_ID && nhdr.n_namesz == 4
+              && std::memcmp(name, "GNU", 4) == 0) {
+            build_id.assign(desc, nhdr.n_descsz);
+            return 1;
+          }
+          cursor = desc + ((nhdr.n_descsz + 3) & ~3u);
+        }
+      }
+      return 1;
+    },
+    &build_id
+  );
+  std::uint64_t hash = 14695981039346656037u;
+  auto mix = [&hash](const char *data, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+      hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211u;
+    }
+  };
+  if (!build_id.empty()) {
+    mix(build_id.data(), build_id.size());
+  } else {
+    int fd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return std::string {};
+    }
+    char buf[65536];
+    ssize_t actual;
+    while ((actual = ::read(fd, buf, sizeof(buf))) > 0) {
+      mix(buf, static_cast<std::size_t>(actual));
+    }
+    close(fd);
+    if (actual < 0) {
+      return std::string {};
+    }
+  }
+  std::ostringstream strm;
+  strm << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return strm.str();
 }
 
-const char *eq_t::get_name() const {
-  return "EQ";
-}
+// The names of the fixtures which passed when they last ran, as long as this
+// build of the program is the one which ran them.  The file holds the build
+// ID on its first line and then one name per line.
+class cache_t final {
+public:
 
-const char *ne_t::get_name() const {
-  return "NE";
-}
+  explicit cache_t(std::string build_id_)
+      : build_id(std::move(build_id_)) {}
 
-const char *lt_t::get_name() const {
-  return "LT";
-}
+  cache_t(const cache_t &) = delete;
 
-const char *le_t::get_name() const {
-  return "LE";
-}
+  cache_t &operator=(const cache_t &) = delete;
 
-const char *gt_t::get_name() const {
-  return "GT";
-}
+  bool has_passed(const std::string &name) const {
+    return passes.count(name) != 0;
+  }
 
-const char *ge_t::get_name() const {
-  return "GE";
-}
+  void set(const std::string &name, bool ok) {
+    if (ok) {
+      passes.insert(name);
+    } else {
+      passes.erase(name);
+    }
+  }
 
-const char *almost_eq_t::get_name() const {
-  return "ALMOST_EQ";
+  // Loads the file at the path, if there is one and it's from this build.
+  void load(const std::string &path) {
+    std::ifstream strm { path };
+    std::string line;
+    if (build_id.empty() || !std::getline(strm, line) || line != build_id) {
+      return;
+    }
+    while (std::getline(strm, line)) {
+      passes.insert(line);
+    }
+  }
+
+  void save(const std::string &path) const {
+    replace_file(
+        path,
+        [this](std::ostream &strm) {
+          strm << build_id << '\n';
+          for (const auto &name : passes) {
+            strm << name << '\n';
+          }
+        }
+    );
+  }
+
+private:
+
+  std::string build_id;
+
+  std::set<std::string> passes;
+
+};  // cache_t
+
+void history_t::load(const std::string &path) {
+  std::ifstream strm { path };
+  double wall;
+  std::string name;
+  while (strm >> wall >> name) {
+    walls[name] = wall;
+  }
 }
 
-const char *not_almost_eq_t::get_name() const {
-  return "NOT_ALMOST_EQ";
+void history_t::save(const std::string &path) const {
+  replace_file(
+      path,
+      [this](std::ostream &strm) {
+        strm << std::setprecision(9);
+        for (const auto &pair : walls) {
+          strm << pair.second << ' ' << pair.first << '\n';
+        }
+      }
+  );
 }
 
-}  // predicate
+// Chooses which of the fixtures belong to the configured shard.  Taking the
+// fixtures from longest to shortest by their time in the history, each goes
+// to the shard with the least total time so far.  A fixture with no history
+// counts as taking the mean time of those with one.  Since this depends only
+// on the fixtures and the history, every shard which sees the same history
+// comes to the same partition, so each fixture runs in exactly one shard.
+static std::vector<bool> pick_shard(
+    const cfg_t &cfg, const history_t &history,
+    const std::vector<const fixture_t *> &fixtures) {
+  auto shard_cnt = static_cast<std::size_t>(cfg.get_shard_cnt());
+  auto shard_idx = static_cast<std::size_t>(cfg.get_shard_idx());
+  std::vector<double> walls(fixtures.size());
+  double known_wall = 0;
+  std::size_t known_cnt = 0;
+  for (std::size_t idx = 0; idx < fixtures.size(); ++idx) {
+    walls[idx] = history.get(fixtures[idx]->get_name());
+    if (walls[idx] > 0) {
+      known_wall += walls[idx];
+      ++known_cnt;
+    }
+  }
+  double unknown_wall = known_cnt ? (known_wall / known_cnt) : 1;
+  for (auto &wall : walls) {
+    if (wall <= 0) {
+      wall = unknown_wall;
+    }
+  }
+  std::vector<std::size_t> idxs(fixtures.size());
+  for (std::size_t idx = 0; idx < fixtures.size(); ++idx) {
+    idxs[idx] = idx;
+  }
+  std::stable_sort(
+      idxs.begin(), idxs.end(),
+      [&](std::size_t lhs, std::size_t rhs) {
+        return walls[lhs] > walls[rhs];
+      }
+  );
+  std::vector<double> loads(shard_cnt, 0);
+  std::vector<bool> picks(fixtures.size());
+  for (auto idx : idxs) {
+    auto shard = static_cast<std::size_t>(
+        std::min_element(loads.begin(), loads.end()) - loads.begin());
+    loads[shard] += walls[idx];
+    picks[idx] = (shard == shard_idx);
+  }
+  return picks;
+}
 
-expectation_t::expectation_t(const loc_t &loc_, const predicate_t &predicate_)
-    : loc(loc_), predicate(predicate_), ok(predicate) {}
+// Lists the events which the system won't count, if any.
+static void write_uncounted(std::ostream &strm) {
+  auto counters = event_counter_t {}.stop();
+  const char *sep = "";
+  for (std::size_t i = 0; i < event_cnt; ++i) {
+    auto event = static_cast<event_t>(i);
+    if (!counters.has(event)) {
+      strm << (*sep ? sep : "counters; can't count ") << event;
+      sep = ", ";
+    }
+  }
+  if (*sep) {
+    strm << '\n';
+  }
+}
 
-expectation_t::~expectation_t() {
-  auto *ctxt = ctxt_t::get_singleton();
-  if (!ok) {
-    ctxt->fail();
+// Lists the slowest fixtures by wall-clock time, with the total time taken by
+// all the fixtures and by the run as a whole.
+static void write_slowest(
+    const cfg_t &cfg, const std::vector<const slate_t *> &slates,
+    double elapsed) {
+  auto &strm = cfg.get_strm();
+  double wall = 0, cpu = 0;
+  std::vector<std::pair<const fixture_t *, const outcome_t *>> ran;
+  for (const auto *slate : slates) {
+    for (std::size_t idx = 0; idx < slate->size(); ++idx) {
+      const auto &outcome = slate->outcomes[idx];
+      ran.emplace_back(slate->fixtures[idx], &outcome);
+      wall += outcome.wall;
+      cpu += outcome.cpu;
+    }
   }
-  auto &cfg = ctxt->get_cfg();
-  if (!ok || cfg.get_verbosity() >= 2) {
-    auto &strm = ctxt->get_strm();
+  auto slow_cnt = std::min(
+      ran.size(), static_cast<std::size_t>(cfg.get_slow_cnt()));
+  std::partial_sort(
+      ran.begin(), ran.begin() + static_cast<std::ptrdiff_t>(slow_cnt),
+      ran.end(),
+      [](
+          const std::pair<const fixture_t *, const outcome_t *> &lhs,
+          const std::pair<const fixture_t *, const outcome_t *> &rhs) {
+        return lhs.second->wall > rhs.second->wall;
+      }
+  );
+  strm
+      << "slowest " << slow_cnt << " of " << ran.size() << separator
+      << "total " << dur_t { elapsed } << " elapsed" << separator
+      << dur_t { wall } << " wall" << separator
+      << dur_t { cpu } << " cpu" << '\n';
+  for (std::size_t i = 0; i < slow_cnt; ++i) {
+    const auto &fixture = *ran[i].first;
+    const auto &outcome = *ran[i].second;
     strm
         << indent_t { 1 }
-        << loc << separator
-        << pf_t { ok } << separator
-        << src_of(predicate);
-    predicate.for_each_operand(
-      [&](const any_operand_t &operand) {
-        const char *src = operand.get_src();
-        if (!isdigit(*src) && *src != '\'' && *src != '"') {
-          strm << separator << src << '=' << val_of(operand);
-        }
-        return true;
-      }
-    );
-    auto extra = string_builder.str();
-    if (!extra.empty()) {
-      strm << separator << extra;
-    }
-    strm << std::endl;
+        << dur_t { outcome.wall } << " wall" << separator
+        << dur_t { outcome.cpu } << " cpu" << separator
+        << bold << fixture.get_name() << plain << separator
+        << fixture.get_loc() << '\n';
   }
 }
 
 bool run_fixtures(const cfg_t &cfg) {
+  out_session_t session { cfg };
   auto &strm = cfg.get_strm();
-  int pass_cnt = 0, fail_cnt = 0, skip_cnt = 0;
+  auto start_time = get_wall_time();
+  tally_t tally;
+  std::vector<const fixture_t *> chosen;
   fixture_t::for_each(
     [&](const fixture_t &fixture) {
-      if (std::regex_match(fixture.get_name(), cfg.get_regex())) {
-        ++(fixture(cfg) ? pass_cnt : fail_cnt);
+      if ((fixture.is_bench() ? cfg.runs_benches() : cfg.runs_tests())
+          && cfg.get_selector().matches(fixture)) {
+        chosen.push_back(&fixture);
       } else {
-        ++skip_cnt;
+        tally.skip();
       }
       return true;
     }
   );
+  history_t history;
+  const auto &history_path = cfg.get_history_path();
+  if (!history_path.empty()) {
+    history.load(history_path);
+  }
+  auto picks = (cfg.get_shard_cnt() > 1)
+      ? pick_shard(cfg, history, chosen)
+      : std::vector<bool>(chosen.size(), true);
+  const auto &cache_path = cfg.get_cache_path();
+  cache_t cache { cache_path.empty() ? std::string {} : get_build_id() };
+  if (!cache_path.empty()) {
+    cache.load(cache_path);
+  }
+  /* Benchmarks always run, since what they measure isn't a pass. */
+  slate_t tests { cfg, tally, start_time },
+      benches { cfg, tally, start_time };
+  for (std::size_t idx = 0; idx < chosen.size(); ++idx) {
+    const auto &fixture = *chosen[idx];
+    if (!picks[idx]) {
+      tally.skip();
+    } else if (fixture.is_bench()) {
+      benches.add(fixture);
+    } else if (!cfg.is_forced() && cache.has_passed(fixture.get_name())) {
+      tally.skip_cached();
+    } else {
+      tests.add(fixture);
+    }
+  }
+  if (!cfg.keeps_resources()) {
+    for (const auto *slate : { &tests, &benches }) {
+      for (const auto *fixture : slate->fixtures) {
+        add_resource_users(*fixture);
+      }  // for
+    }  // for
+  }
+  if (cfg.counts_events() && cfg.get_verbosity() >= 1) {
+    write_uncounted(strm);
+  }
+  for (const auto &reporter : cfg.get_reporters()) {
+    reporter->on_begin_run();
+  }
+  if (cfg.get_fork_batch() > 0) {
+    run_in_forks(tests);
+  } else if (cfg.get_jobs() > 1) {
+    run_on_threads(tests);
+  } else {
+    run_serially(tests);
+  }
+  /* Benchmarks run after the tests and one at a time, so that they don't
+     compete with each other or with the tests for the machine. */
+  run_serially(benches);
+  int pass_cnt = tally.pass_cnt, fail_cnt = tally.fail_cnt,
+      skip_cnt = tally.skip_cnt, cache_cnt = tally.cache_cnt;
   bool ok = cfg.is_strict()
-      ? (pass_cnt != 0 && fail_cnt == 0)
+      ? (pass_cnt + cache_cnt != 0 && fail_cnt == 0)
       : (fail_cnt == 0);
+  auto elapsed = get_wall_time() - start_time;
   if (!ok || cfg.get_verbosity() >= 1) {
     strm
         << "passed " << pass_cnt << separator
         << "failed " << fail_cnt << separator
-        << "skipped " << skip_cnt << separator
-        << pf_t { ok } << std::endl;
+        << "skipped " << skip_cnt << separator;
+    if (!cache_path.empty()) {
+      strm << "cached " << cache_cnt << separator;
+    }
+    strm << pf_t { ok } << '\n';
+  }
+  if (cfg.get_slow_cnt() > 0) {
+    write_slowest(cfg, { &tests, &benches }, elapsed);
+  }
+  if (!history_path.empty()) {
+    for (const auto *slate : { &tests, &benches }) {
+      for (std::size_t idx = 0; idx < slate->size(); ++idx) {
+        history.set(
+            slate->fixtures[idx]->get_name(), slate->outcomes[idx].wall);
+      }
+    }
+    history.save(history_path);
+  }
+  const auto &save_baseline_path = cfg.get_save_baseline_path();
+  if (!save_baseline_path.empty()) {
+    baseline_t baseline;
+    baseline.load(save_baseline_path);
+    for (std::size_t idx = 0; idx < benches.size(); ++idx) {
+      const auto &outcome = benches.outcomes[idx];
+      if (!outcome.samples.empty()) {
+        baseline.set(benches.fixtures[idx]->get_name(), outcome.samples);
+      }
+    }
+    baseline.save(save_baseline_path);
+  }
+  if (!cache_path.empty()) {
+    for (std::size_t idx = 0; idx < tests.size(); ++idx) {
+      cache.set(tests.fixtures[idx]->get_name(), tests.outcomes[idx].ok);
+    }
+    cache.save(cache_path);
+  }
+  summary_t summary {
+    pass_cnt, fail_cnt, skip_cnt, cache_cnt, ok, elapsed
+  };
+  for (const auto &reporter : cfg.get_reporters()) {
+    reporter->on_end_run(summary);
   }
   return ok;
 }
@@ -304,11 +4945,173 @@ int main(int argc, char *argv[]) {
     std::cerr << stalled.msg << std::endl;
     return EXIT_FAILURE;
   }
-  return stalled.ret ? EXIT_SUCCESS : EXIT_FAILURE;
+  return *stalled.ret ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 }  // lick
 
+/* Define LICK_NO_MAIN when building lick to leave out main(), as for a
+   driver with a main() of its own, like lick-reload. */
+#if !defined(LICK_NO_MAIN)
+
 int main(int argc, char *argv[]) {
   return lick::main(argc, argv);
 }
+
+#endif
+
+#if !defined(LICK_NO_ALLOC_HOOKS)
+
+/* The replacements for the global allocation functions, which feed the
+   allocation meter.  Define LICK_NO_ALLOC_HOOKS when building lick to leave
+   them out, for instance if the program replaces them itself; the meter then
+   counts nothing. */
+
+namespace lick {
+
+// Allocates with malloc(), or, for alignments beyond what it guarantees,
+// with posix_memalign().  Either way, free() frees the block.
+static void *alloc(std::size_t size, std::size_t align, bool throws) {
+  if (size == 0) {
+    size = 1;
+  }
+  for (;;) {
+    void *ptr = nullptr;
+    if (align <= alignof(std::max_align_t)) {
+      ptr = std::malloc(size);
+    } else if (posix_memalign(&ptr, align, size) != 0) {
+      ptr = nullptr;
+    }
+    if (ptr) {
+      if (LICK_UNLIKELY(meter.on)) {
+        meter.on_alloc(ptr);
+      }
+      return ptr;
+    }
+    auto handler = std::get_new_handler();
+    if (!handler) {
+      if (throws) {
+        throw std::bad_alloc {};
+      }
+      return nullptr;
+    }
+    handler();
+  }
+}
+
+static void dealloc(void *ptr) noexcept {
+  if (LICK_UNLIKELY(meter.on) && ptr) {
+    meter.on_free(ptr);
+  }
+  std::free(ptr);
+}
+
+}  // lick
+
+void *operator new(std::size_t size) {
+  return lick::alloc(size, 0, true);
+}
+
+void *operator new[](std::size_t size) {
+  return lick::alloc(size, 0, true);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return lick::alloc(size, 0, false);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return lick::alloc(size, 0, false);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *ptr) noexcept {
+  lick::dealloc(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  lick::dealloc(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  lick::dealloc(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  lick::dealloc(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  lick::dealloc(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+  lick::dealloc(ptr);
+}
+
+#if defined(__cpp_aligned_new)
+
+void *operator new(std::size_t size, std::align_val_t align) {
+  return lick::alloc(size, static_cast<std::size_t>(align), true);
+}
+
+void *operator new[](std::size_t size, std::align_val_t align) {
+  return lick::alloc(size, static_cast<std::size_t>(align), true);
+}
+
+void *operator new(
+    std::size_t size, std::align_val_t align,
+    const std::nothrow_t &) noexcept {
+  try {
+    return lick::alloc(size, static_cast<std::size_t>(align), false);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void *operator new[](
+    std::size_t size, std::align_val_t align,
+    const std::nothrow_t &) noexcept {
+  try {
+    return lick::alloc(size, static_cast<std::size_t>(align), false);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+  lick::dealloc(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+  lick::dealloc(ptr);
+}
+
+void operator delete(
+    void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+  lick::dealloc(ptr);
+}
+
+void operator delete[](
+    void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+  lick::dealloc(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+  lick::dealloc(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept {
+  lick::dealloc(ptr);
+}
+
+#endif
+
+#endif
@@ -16,34 +16,254 @@ limitations under the License.
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <functional>
+#include <iterator>
 #include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <ostream>
-#include <regex>
 #include <stdexcept>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Coroutine fixtures need C++20.  Lick itself builds without it; it drives
+// their coroutines through functions which their own translation units
+// provide.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define LICK_HAS_COROUTINES 1
+#include <coroutine>
+#include <exception>
+#endif
+
+#if defined(__GNUC__)
+#define LICK_COLD __attribute__((cold, noinline))
+#define LICK_UNUSED __attribute__((unused))
+#define LICK_UNLIKELY(cond) __builtin_expect(!!(cond), 0)
+#else
+#define LICK_COLD
+#define LICK_UNUSED
+#define LICK_UNLIKELY(cond) (cond)
+#endif
+
+// Declares the record of a fixture.  The records are constants which the
+// linker gathers into one section, back to back, so that they make an array
+// without any code running to register them.  The alignment is given
+// explicitly so that the compiler can't pad the records apart.  Where there's
+// no such section, each record enrolls itself among the others as the
+// program starts, in link order and then in definition order.
+#if defined(__GNUC__) && defined(__ELF__)
+#define LICK_FIXTURE_SECTION 1
+#define LICK_FIXTURE_RECORD(name)                                       \
+  __attribute__((                                                       \
+      used, section("lick_fixtures"),                                   \
+      aligned(alignof(::lick::fixture_t))))                             \
+  static constexpr ::lick::fixture_t lick_fixture__##name
+#else
+#define LICK_FIXTURE_RECORD(name)                                       \
+  static const ::lick::enrolled_fixture_t lick_fixture__##name
+#endif
 
 // Marks the current file:line position within source code.
 #define HERE ::lick::loc_t { __FILE__, __LINE__ }
 
 // Define a test fixture.
-#define FIXTURE(name)                               \
-  static void name();                               \
-  static const ::lick::fixture_t                    \
-      lick_fixture__##name { HERE, #name, name };   \
+#define FIXTURE(name)                                       \
+  static void name();                                       \
+  LICK_FIXTURE_RECORD(name) { HERE, #name, name };          \
   static void name()
 
+// Define a test fixture which may run for no longer than the given number of
+// seconds, whatever the --timeout option says.
+#define FIXTURE_TIMEOUT(name, timeout)                          \
+  static void name();                                           \
+  LICK_FIXTURE_RECORD(name) { HERE, #name, name, timeout };     \
+  static void name()
+
+// Define a test fixture with tags, given as one string of words separated by
+// spaces or commas, like this:
+//   FIXTURE_TAGS(parse_big_file, "slow io") {
+//     ...
+//   }
+// The -n option can then select fixtures by tag.
+#define FIXTURE_TAGS(name, tags)                                \
+  static void name();                                           \
+  LICK_FIXTURE_RECORD(name) { HERE, #name, name, 0, tags };     \
+  static void name()
+
+// Define a test fixture which uses resources declared by RESOURCE or
+// EXTERN_RESOURCE, like this:
+//   FIXTURE_USING(lookup_hits, rows, index) {
+//     EXPECT_EQ(index->find(rows->front().key), 0u);
+//   }
+// A fixture may use only the resources it names.
+#define FIXTURE_USING(name, ...)                                        \
+  static void name();                                                   \
+  static constexpr ::lick::resource_t *const lick_uses__##name[] = {    \
+    __VA_ARGS__, nullptr                                                \
+  };                                                                    \
+  LICK_FIXTURE_RECORD(name) { HERE, #name, lick_uses__##name, name };   \
+  static void name()
+
+// Define a resource shared by fixtures, of the given type, which the body
+// builds and returns, like this:
+//   RESOURCE(rows, std::vector<row_t>) {
+//     return load_rows("big.csv");
+//   }
+// The resource is built the first time a fixture which uses it asks for it,
+// shared read-only by the fixtures after, and torn down once the last of
+// the fixtures chosen to run which use it is done.  A type with commas in it
+// needs an alias.  A resource so defined may be declared in other files by
+// EXTERN_RESOURCE.
+#define RESOURCE(name, type)                                            \
+  static type lick_build__##name();                                     \
+  ::lick::resource_of_t<type> lick_resource__##name {                   \
+    #name, lick_build__##name                                           \
+  };                                                                    \
+  static constexpr ::lick::resource_ref_t<type> name {                  \
+    &lick_resource__##name                                              \
+  };                                                                    \
+  static type lick_build__##name()
+
+// Declare a resource defined by RESOURCE in another file.
+#define EXTERN_RESOURCE(name, type)                                     \
+  extern ::lick::resource_of_t<type> lick_resource__##name;             \
+  static constexpr ::lick::resource_ref_t<type> name {                  \
+    &lick_resource__##name                                              \
+  }
+
+// Define a stress fixture, whose body runs on the given number of threads at
+// once.  The threads wait at a barrier until all have started, so that they
+// contend from the first.  The body gets its thread's index, from 0, as
+// 'thread_idx', and may count the operations it does in 'op_cnt', so that
+// each thread's throughput can be reported, like this:
+//   STRESS_FIXTURE(push_pop, 8) {
+//     for (int i = 0; i < 100000; ++i) {
+//       queue.push(i);
+//       EXPECT(queue.pop());
+//       ++op_cnt;
+//     }
+//   }
+// Expectations on any of the threads report to the fixture.
+#define STRESS_FIXTURE(name, threads)                                   \
+  static void name(std::size_t, std::uint64_t &);                       \
+  LICK_FIXTURE_RECORD(name) { HERE, #name, name, threads };             \
+  static void name(                                                     \
+      LICK_UNUSED std::size_t thread_idx,                               \
+      LICK_UNUSED std::uint64_t &op_cnt)
+
+// Define a coroutine fixture, which may co_await timers and file descriptors
+// on lick's event loop, and other coroutines which return lick::task_t, like
+// this:
+//   ASYNC_FIXTURE(echo) {
+//     co_await lick::writable(sock);
+//     EXPECT_EQ(write(sock, "hi", 2), 2);
+//     co_await lick::readable(sock);
+//     ...
+//   }
+// Coroutine fixtures run interleaved on one thread, and each expectation
+// reports to the fixture whose coroutine made it.  Needs C++20.
+#if defined(LICK_HAS_COROUTINES)
+#define ASYNC_FIXTURE(name)                                             \
+  static ::lick::task_t name();                                         \
+  static void *lick_start__##name() {                                   \
+    return name().release();                                            \
+  }                                                                     \
+  static constexpr ::lick::async_fixture_t lick_async__##name {         \
+    lick_start__##name, ::lick::task_t::resume, ::lick::task_t::is_done, \
+    ::lick::task_t::finish, ::lick::task_t::destroy                     \
+  };                                                                    \
+  LICK_FIXTURE_RECORD(name) { HERE, #name, &lick_async__##name };       \
+  static ::lick::task_t name()
+#endif
+
+// Define a parameterized fixture, which runs once for each row of a table.
+// The body gets the row as 'row', like this:
+//   static const int sizes[] = { 0, 1, 7, 4096 };
+//   FIXTURE_P(reserve, sizes) {
+//     std::vector<char> v;
+//     v.reserve(row);
+//     EXPECT_GE(v.capacity(), row);
+//   }
+// The table may be an array or any container, and must outlive the fixture.
+// Each row runs as a fixture of its own, named for the row's index, like
+// "reserve/3".
+#define FIXTURE_P(name, table)                                          \
+  static void name(const ::lick::row_of_t<decltype(table)> &);          \
+  static void lick_rows__##name(                                        \
+      const ::lick::param_fixture_t::row_cb_t &cb) {                    \
+    ::lick::for_each_row(table, cb);                                    \
+  }                                                                     \
+  static void lick_run_row__##name(const void *row) {                   \
+    name(*static_cast<const ::lick::row_of_t<decltype(table)> *>(row)); \
+  }                                                                     \
+  static constexpr ::lick::param_fixture_t lick_param__##name {         \
+    lick_rows__##name, lick_run_row__##name                             \
+  };                                                                    \
+  LICK_FIXTURE_RECORD(name) { HERE, #name, &lick_param__##name };       \
+  static void name(const ::lick::row_of_t<decltype(table)> &row)
+
+// Define a property: a fixture which runs its body on many random cases of
+// values made by up to four generators, which the body gets as 'arg0',
+// 'arg1', and so on, like this:
+//   PROPERTY(reverse_twice, lick::gen::vectors(lick::gen::ints())) {
+//     auto copy = arg0;
+//     std::reverse(copy.begin(), copy.end());
+//     std::reverse(copy.begin(), copy.end());
+//     EXPECT(copy == arg0);
+//   }
+// A failing case is shrunk to the simplest values which still fail, then
+// reported with the seed which reproduces it.  See check_property().
+#define PROPERTY(name, ...)                                             \
+  using lick_gens__##name = decltype(std::make_tuple(__VA_ARGS__));     \
+  static void name(                                                     \
+      const ::lick::arg_of_t<lick_gens__##name, 0> &,                   \
+      const ::lick::arg_of_t<lick_gens__##name, 1> &,                   \
+      const ::lick::arg_of_t<lick_gens__##name, 2> &,                   \
+      const ::lick::arg_of_t<lick_gens__##name, 3> &);                  \
+  static void lick_property__##name() {                                 \
+    ::lick::check_property(                                             \
+        HERE, std::make_tuple(__VA_ARGS__), name);                      \
+  }                                                                     \
+  LICK_FIXTURE_RECORD(name) { HERE, #name, lick_property__##name };    \
+  static void name(                                                     \
+      LICK_UNUSED const ::lick::arg_of_t<lick_gens__##name, 0> &arg0,   \
+      LICK_UNUSED const ::lick::arg_of_t<lick_gens__##name, 1> &arg1,   \
+      LICK_UNUSED const ::lick::arg_of_t<lick_gens__##name, 2> &arg2,   \
+      LICK_UNUSED const ::lick::arg_of_t<lick_gens__##name, 3> &arg3)
+
+// Define a benchmark.  The body loops on 'state', like this:
+//   BENCHMARK(push_back) {
+//     std::vector<int> v;
+//     for (auto _ : state) {
+//       v.push_back(1);
+//     }
+//   }
+#define BENCHMARK(name)                                     \
+  static void name(::lick::state_t &);                      \
+  LICK_FIXTURE_RECORD(name) { HERE, #name, name };          \
+  static void name(::lick::state_t &state)
+
 // Defines an expectation that the operand is true.
 #define EXPECT(operand) (                           \
       ::lick::expectation_t {                       \
         HERE,                                       \
-        ::lick::predicate::true_t {                 \
+        ::lick::check<::lick::predicate::true_t>(   \
           ::lick::as_operand(#operand, operand)     \
-        }                                           \
+        )                                           \
       }                                             \
     )
 
@@ -51,9 +271,9 @@ limitations under the License.
 #define EXPECT_NOT(operand) (                       \
       ::lick::expectation_t {                       \
         HERE,                                       \
-        ::lick::predicate::false_t {                \
+        ::lick::check<::lick::predicate::false_t>(  \
           ::lick::as_operand(#operand, operand)     \
-        }                                           \
+        )                                           \
       }                                             \
     )
 
@@ -61,10 +281,10 @@ limitations under the License.
 #define EXPECT_EQ(lhs, rhs) (                       \
       ::lick::expectation_t {                       \
         HERE,                                       \
-        ::lick::predicate::eq_t {                   \
+        ::lick::check<::lick::predicate::eq_t>(     \
           ::lick::as_operand(#lhs, lhs),            \
           ::lick::as_operand(#rhs, rhs)             \
-        }                                           \
+        )                                           \
       }                                             \
     )
 
@@ -72,10 +292,10 @@ limitations under the License.
 #define EXPECT_NE(lhs, rhs) (                       \
       ::lick::expectation_t {                       \
         HERE,                                       \
-        ::lick::predicate::ne_t {                   \
+        ::lick::check<::lick::predicate::ne_t>(     \
           ::lick::as_operand(#lhs, lhs),            \
           ::lick::as_operand(#rhs, rhs)             \
-        }                                           \
+        )                                           \
       }                                             \
     )
 
@@ -83,10 +303,10 @@ limitations under the License.
 #define EXPECT_LT(lhs, rhs) (                       \
       ::lick::expectation_t {                       \
         HERE,                                       \
-        ::lick::predicate::lt_t {                   \
+        ::lick::check<::lick::predicate::lt_t>(     \
           ::lick::as_operand(#lhs, lhs),            \
           ::lick::as_operand(#rhs, rhs)             \
-        }                                           \
+        )                                           \
       }                                             \
     )
 
@@ -94,10 +314,10 @@ limitations under the License.
 #define EXPECT_LE(lhs, rhs) (                       \
       ::lick::expectation_t {                       \
         HERE,                                       \
-        ::lick::predicate::le_t {                   \
+        ::lick::check<::lick::predicate::le_t>(     \
           ::lick::as_operand(#lhs, lhs),            \
           ::lick::as_operand(#rhs, rhs)             \
-        }                                           \
+        )                                           \
       }                                             \
     )
 
@@ -105,10 +325,10 @@ limitations under the License.
 #define EXPECT_GT(lhs, rhs) (                       \
       ::lick::expectation_t {                       \
         HERE,                                       \
-        ::lick::predicate::gt_t {                   \
+        ::lick::check<::lick::predicate::gt_t>(     \
           ::lick::as_operand(#lhs, lhs),            \
           ::lick::as_operand(#rhs, rhs)             \
-        }                                           \
+        )                                           \
       }                                             \
     )
 
@@ -116,35 +336,143 @@ limitations under the License.
 #define EXPECT_GE(lhs, rhs) (                       \
       ::lick::expectation_t {                       \
         HERE,                                       \
-        ::lick::predicate::ge_t {                   \
+        ::lick::check<::lick::predicate::ge_t>(     \
           ::lick::as_operand(#lhs, lhs),            \
           ::lick::as_operand(#rhs, rhs)             \
-        }                                           \
+        )                                           \
       }                                             \
     )
 
+// Defines an expectation that two floating-point numbers are almost equal.
+// The tolerance is a coefficient of epsilon, or one of lick::ulps(n),
+// lick::rel_tol(rel, abs) or lick::abs_tol(abs).
 #define EXPECT_ALMOST_EQ(lhs, rhs, coef) (          \
       ::lick::expectation_t {                       \
         HERE,                                       \
-        ::lick::predicate::almost_eq_t {            \
+        ::lick::check<                              \
+            ::lick::predicate::almost_eq_t>(        \
           ::lick::as_operand(#lhs, lhs),            \
           ::lick::as_operand(#rhs, rhs),            \
           ::lick::as_operand(#coef, coef)           \
-        }                                           \
+        )                                           \
       }                                             \
     )
 
 #define EXPECT_NOT_ALMOST_EQ(lhs, rhs, coef) (      \
       ::lick::expectation_t {                       \
         HERE,                                       \
-        ::lick::predicate::not_almost_eq_t {        \
+        ::lick::check<                              \
+            ::lick::predicate::not_almost_eq_t>(    \
           ::lick::as_operand(#lhs, lhs),            \
           ::lick::as_operand(#rhs, rhs),            \
           ::lick::as_operand(#coef, coef)           \
-        }                                           \
+        )                                           \
       }                                             \
     )
 
+// Defines a region of code which must not allocate with operator new, like
+// this:
+//   EXPECT_NO_ALLOC {
+//     queue.push(item);
+//   }
+// Only allocations by the thread which runs the region count.
+#define EXPECT_NO_ALLOC                                         \
+  for (::lick::alloc_region_t lick_alloc_region { HERE };       \
+      lick_alloc_region.loop();)
+
+// Defines a region of code which may allocate with operator new no more than
+// the given number of times.
+#define EXPECT_ALLOCS_LE(limit)                                 \
+  for (::lick::alloc_region_t lick_alloc_region {               \
+        HERE, #limit, static_cast<std::size_t>(limit) };        \
+      lick_alloc_region.loop();)
+
+// Defines an expectation that the callable's median run time is less than the
+// budget, given in seconds or as a std::chrono::duration.  The callable runs
+// many times; see time_runs().
+#define EXPECT_DURATION_LT(fn, budget) (                        \
+      ::lick::expectation_t {                                   \
+        HERE,                                                   \
+        ::lick::check<::lick::predicate::duration_lt_t>(        \
+          ::lick::as_operand(#fn, ::lick::time_runs(fn)),       \
+          ::lick::as_operand(#budget, budget)                   \
+        )                                                       \
+      }                                                         \
+    )
+
+// Defines an expectation that the given percentile of the callable's run
+// times is less than the budget.
+#define EXPECT_PERCENTILE_LT(fn, pct, budget) (                 \
+      ::lick::expectation_t {                                   \
+        HERE,                                                   \
+        ::lick::check<::lick::predicate::percentile_lt_t>(      \
+          ::lick::as_operand(#fn, ::lick::time_runs(fn)),       \
+          ::lick::as_operand(#pct, pct),                        \
+          ::lick::as_operand(#budget, budget)                   \
+        )                                                       \
+      }                                                         \
+    )
+
+// Defines an expectation that the counters, from count_events(), show fewer
+// than the given number of events of the given kind per operation, like this:
+//   auto counters = lick::count_events(parse_all, 1000);
+//   EXPECT_PER_OP_LT(counters, instrs, 500);
+// Where the system can't count the event, the expectation passes.
+#define EXPECT_PER_OP_LT(counters, event, limit) (              \
+      ::lick::expectation_t {                                   \
+        HERE,                                                   \
+        ::lick::check<::lick::predicate::per_op_lt_t>(          \
+          ::lick::as_operand(#counters, counters),              \
+          ::lick::as_operand(#event, ::lick::event_t::event),   \
+          ::lick::as_operand(#limit, limit)                     \
+        )                                                       \
+      }                                                         \
+    )
+
+// Defines an expectation that two ranges of values are the same size and
+// equal, element by element.  A range is an array, a container with
+// contiguous storage, such as std::vector, or a span from as_span(ptr, size).
+// The values are compared with vector instructions, so even long ranges are
+// cheap to check, and only the first few misses are reported.
+#define EXPECT_RANGE_EQ(lhs, rhs)                               \
+    EXPECT_RANGE_OP(range_eq_t, lhs, rhs)
+
+// Defines expectations that each value of the lhs range compares to the
+// corresponding value of the rhs range as the name says.
+#define EXPECT_RANGE_LT(lhs, rhs)                               \
+    EXPECT_RANGE_OP(range_lt_t, lhs, rhs)
+#define EXPECT_RANGE_LE(lhs, rhs)                               \
+    EXPECT_RANGE_OP(range_le_t, lhs, rhs)
+#define EXPECT_RANGE_GT(lhs, rhs)                               \
+    EXPECT_RANGE_OP(range_gt_t, lhs, rhs)
+#define EXPECT_RANGE_GE(lhs, rhs)                               \
+    EXPECT_RANGE_OP(range_ge_t, lhs, rhs)
+
+// Defines an expectation that two ranges of floats or doubles are the same
+// size and almost equal, pair by pair, within a tolerance, as for
+// EXPECT_ALMOST_EQ.  A failure reports the greatest and mean distances in
+// ULPs, the worst pair, and a histogram of the distances.
+#define EXPECT_RANGE_ALMOST_EQ(lhs, rhs, tol) (                 \
+      ::lick::expectation_t {                                   \
+        HERE,                                                   \
+        ::lick::check<::lick::predicate::range_almost_eq_t>(    \
+          ::lick::as_operand(#lhs, ::lick::as_span(lhs)),       \
+          ::lick::as_operand(#rhs, ::lick::as_span(rhs)),       \
+          ::lick::as_operand(#tol, tol)                         \
+        )                                                       \
+      }                                                         \
+    )
+
+#define EXPECT_RANGE_OP(pred, lhs, rhs) (                       \
+      ::lick::expectation_t {                                   \
+        HERE,                                                   \
+        ::lick::check<::lick::predicate::pred>(                 \
+          ::lick::as_operand(#lhs, ::lick::as_span(lhs)),       \
+          ::lick::as_operand(#rhs, ::lick::as_span(rhs))        \
+        )                                                       \
+      }                                                         \
+    )
+
 // These macros exist for backward compatibility.
 #define EXPECT_TRUE(operand) EXPECT(operand)
 #define EXPECT_FALSE(operand) EXPECT_NOT(operand)
@@ -199,6 +527,140 @@ bool almost_eq(lhs_t lhs, rhs_t rhs, coef_t coef) {
   return std::fabs(rhs - lhs) < (epsilon * static_cast<lhs_t>(coef));
 }
 
+// The distance between two floating-point numbers in units in the last place:
+// the number of representable values from one to the other.  Zeros of either
+// sign are the same, and a NaN is as far from everything as can be.
+template <typename float_t>
+std::uint64_t get_ulp_distance(float_t lhs, float_t rhs) noexcept {
+  static_assert(
+      std::is_same<float_t, float>::value
+          || std::is_same<float_t, double>::value,
+      "ULPs are measured only for float and double.");
+  using bits_t = typename std::conditional<
+      sizeof(float_t) == 4, std::int32_t, std::int64_t>::type;
+  using ubits_t = typename std::make_unsigned<bits_t>::type;
+  if (lhs != lhs || rhs != rhs) {
+    return std::numeric_limits<std::uint64_t>::max();
+  }
+  bits_t lhs_bits, rhs_bits;
+  std::memcpy(&lhs_bits, &lhs, sizeof(lhs));
+  std::memcpy(&rhs_bits, &rhs, sizeof(rhs));
+  /* Map the sign-magnitude bits onto integers in the same order as the
+     numbers. */
+  static constexpr auto min_bits = std::numeric_limits<bits_t>::min();
+  lhs_bits = (lhs_bits < 0) ? min_bits - lhs_bits : lhs_bits;
+  rhs_bits = (rhs_bits < 0) ? min_bits - rhs_bits : rhs_bits;
+  return (lhs_bits > rhs_bits)
+      ? static_cast<ubits_t>(lhs_bits) - static_cast<ubits_t>(rhs_bits)
+      : static_cast<ubits_t>(rhs_bits) - static_cast<ubits_t>(lhs_bits);
+}
+
+// How close two floating-point numbers must be to be almost equal.  Get one
+// from ulps(), rel_tol() or abs_tol(); a plain number is a coefficient of
+// epsilon, as it has always been.
+class tolerance_t final {
+public:
+
+  enum class kind_t {
+
+    // |lhs - rhs| < epsilon * val
+    coef,
+
+    // The numbers are no more than val ULPs apart.
+    ulps,
+
+    // |lhs - rhs| <= max(val * max(|lhs|, |rhs|), abs)
+    rel,
+
+    // |lhs - rhs| <= val
+    abs
+
+  };  // kind_t
+
+  tolerance_t(kind_t kind_, double val_, double abs_ = 0) noexcept
+      : kind(kind_), val(val_), abs(abs_) {}
+
+  kind_t get_kind() const noexcept {
+    return kind;
+  }
+
+  double get_val() const noexcept {
+    return val;
+  }
+
+  double get_abs() const noexcept {
+    return abs;
+  }
+
+  template <typename float_t>
+  bool admits(float_t lhs, float_t rhs) const noexcept {
+    auto diff = std::fabs(lhs - rhs);
+    switch (kind) {
+      case kind_t::coef: {
+        return diff
+            < std::numeric_limits<float_t>::epsilon()
+                * static_cast<float_t>(val);
+      }
+      case kind_t::ulps: {
+        return get_ulp_distance(lhs, rhs) <= static_cast<std::uint64_t>(val);
+      }
+      case kind_t::rel: {
+        auto scale = std::max(std::fabs(lhs), std::fabs(rhs));
+        return diff
+            <= std::max(
+                static_cast<float_t>(val) * scale,
+                static_cast<float_t>(abs));
+      }
+      case kind_t::abs: {
+        return diff <= static_cast<float_t>(val);
+      }
+    }
+    return false;
+  }
+
+  friend std::ostream &operator<<(
+      std::ostream &strm, const tolerance_t &that);
+
+private:
+
+  kind_t kind;
+
+  double val, abs;
+
+};  // tolerance_t
+
+// Almost equal means no more than the given number of ULPs apart.
+inline tolerance_t ulps(std::uint64_t max_ulps) noexcept {
+  return { tolerance_t::kind_t::ulps, static_cast<double>(max_ulps) };
+}
+
+// Almost equal means apart by no more than the given fraction of the larger
+// magnitude, or by no more than the absolute tolerance, which keeps numbers
+// near zero from having to be identical.
+inline tolerance_t rel_tol(double rel, double abs = 0) noexcept {
+  return { tolerance_t::kind_t::rel, rel, abs };
+}
+
+// Almost equal means apart by no more than the given amount.
+inline tolerance_t abs_tol(double abs) noexcept {
+  return { tolerance_t::kind_t::abs, abs };
+}
+
+inline tolerance_t as_tolerance(const tolerance_t &tol) noexcept {
+  return tol;
+}
+
+template <typename coef_t>
+tolerance_t as_tolerance(const coef_t &coef) noexcept {
+  return { tolerance_t::kind_t::coef, static_cast<double>(coef) };
+}
+
+template <typename lhs_t, typename rhs_t>
+bool almost_eq(lhs_t lhs, rhs_t rhs, const tolerance_t &tol) {
+  using float_t = typename std::common_type<lhs_t, rhs_t, float>::type;
+  return tol.admits(static_cast<float_t>(lhs), static_cast<float_t>(rhs));
+}
+
 // NB: The following four overloads are left intentionally left undefined.
 // Don't compare floating-point numbers for equality.
 // Use ALMOST_EQUALS instead.
@@ -260,6 +722,39 @@ private:
 
 };  // indent_t
 
+// Writes a duration given in seconds, in whichever of s, ms, us or ns suits
+// it best.
+class dur_t final {
+public:
+
+  explicit dur_t(double secs_)
+      : secs(secs_) {}
+
+  friend std::ostream &operator<<(std::ostream &strm, const dur_t &that);
+
+private:
+
+  double secs;
+
+};  // dur_t
+
+// Converts a duration to seconds.  A plain number is already in seconds.
+inline double as_secs(double secs) noexcept {
+  return secs;
+}
+
+template <typename rep_t, typename period_t>
+double as_secs(const std::chrono::duration<rep_t, period_t> &dur) noexcept {
+  return std::chrono::duration_cast<std::chrono::duration<double>>(
+      dur).count();
+}
+
+template <typename rep_t, typename period_t>
+void write(
+    std::ostream &strm, const std::chrono::duration<rep_t, period_t> &val) {
+  strm << dur_t { as_secs(val) };
+}
+
 std::string get_ex_msg(const std::exception &ex);
 
 const std::string &get_ex_msg();
@@ -293,13 +788,21 @@ private:
 class loc_t final {
 public:
 
-  loc_t(const char *file_, int line_)
+  constexpr loc_t(const char *file_, int line_)
       : file(file_), line(line_) {}
 
   loc_t(const loc_t &) = default;
 
   loc_t &operator=(const loc_t &) = default;
 
+  const char *get_file() const noexcept {
+    return file;
+  }
+
+  int get_line() const noexcept {
+    return line;
+  }
+
   friend std::ostream &operator<<(std::ostream &strm, const loc_t &that) {
     return strm << that.file << ':' << that.line;
   }
@@ -390,7 +893,7 @@ public:
 
 private:
 
-  std::aligned_union<sizeof(val_t), val_t> storage;
+  typename std::aligned_union<sizeof(val_t), val_t>::type storage;
 
   bool constructed;
 
@@ -472,270 +975,1838 @@ auto stall(const fn_t &fn, args_t &&... args)
   return { fn, std::forward<args_t>(args)... };
 }
 
-class cfg_t final {
+// Keeps the compiler from optimizing away the computation of a value.
+template <typename val_t>
+inline void do_not_optimize(const val_t &val) {
+#if defined(__GNUC__)
+  asm volatile("" : : "r,m"(val) : "memory");
+#else
+  static volatile const void *sink;
+  sink = &val;
+#endif
+}
+
+// Keeps the compiler from assuming anything about the contents of memory, so
+// that writes before this point can't be elided.
+inline void clobber_memory() {
+#if defined(__GNUC__)
+  asm volatile("" : : : "memory");
+#else
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// The state of one sample of a benchmark.  The benchmark's body loops over
+// the state, which times the loop:
+//   for (auto _ : state) {
+//     ...
+//   }
+class state_t final {
 public:
 
-  cfg_t();
+  using clock_t = std::chrono::steady_clock;
 
-  cfg_t(const cfg_t &) = default;
+  // What the loop variable holds.  It has a user-provided destructor only so
+  // that compilers don't warn when the loop variable goes unused.
+  class tick_t final {
+  public:
 
-  cfg_t &operator=(const cfg_t &) = default;
+    ~tick_t() {}
 
-  const std::regex &get_regex() const noexcept {
-    return regex;
-  }
+  };  // tick_t
 
-  std::ostream &get_strm() const noexcept {
-    return *strm;
-  }
+  class iter_t final {
+  public:
 
-  bool is_strict() const noexcept {
-    return strict;
-  }
+    iter_t(state_t *state_, std::size_t remaining_)
+        : state(state_), remaining(remaining_) {}
 
-  int get_verbosity() const noexcept {
-    return verbosity;
-  }
+    bool operator!=(const iter_t &) {
+      if (LICK_UNLIKELY(remaining == 0)) {
+        state->stop();
+        return false;
+      }
+      return true;
+    }
+
+    iter_t &operator++() {
+      --remaining;
+      return *this;
+    }
+
+    tick_t operator*() const noexcept {
+      return {};
+    }
+
+  private:
+
+    state_t *state;
+
+    std::size_t remaining;
 
-  void set_regex(std::regex regex_) {
-    regex = std::move(regex_);
+  };  // iter_t
+
+  explicit state_t(std::size_t iter_cnt_)
+      : iter_cnt(iter_cnt_), elapsed(0) {}
+
+  state_t(const state_t &) = delete;
+
+  state_t &operator=(const state_t &) = delete;
+
+  iter_t begin() {
+    start_time = clock_t::now();
+    return { this, iter_cnt };
   }
 
-  void set_strm(std::ostream &strm_) {
-    strm = &strm_;
+  iter_t end() {
+    return { this, 0 };
   }
 
-  void set_verbosity(int verbosity_) {
-    verbosity = (verbosity_ < 0) ? 0 : (verbosity_ > 2) ? 2 : verbosity_;
+  clock_t::duration get_elapsed() const noexcept {
+    return elapsed;
   }
 
-  static bool parse(cfg_t &cfg, int argc, char *argv[]);
+  std::size_t get_iter_cnt() const noexcept {
+    return iter_cnt;
+  }
 
 private:
 
-  std::ostream *strm;
-
-  std::regex regex;
+  void stop() {
+    elapsed = clock_t::now() - start_time;
+  }
 
-  int verbosity;
+  std::size_t iter_cnt;
 
-  bool strict;
+  clock_t::time_point start_time;
 
-};  // cfg_t
+  clock_t::duration elapsed;
 
-class fixture_t;
+};  // state_t
 
-class ctxt_t final {
+// The run times of a callable, in seconds, in order from fastest to slowest.
+// See time_runs().
+class durations_t final {
 public:
 
-  ctxt_t(const fixture_t *fixture, const cfg_t &cfg);
-
-  ~ctxt_t();
-
-  ctxt_t(const ctxt_t &) = delete;
+  durations_t(std::vector<double> secs, int warmup_cnt);
 
-  ctxt_t &operator=(const ctxt_t &) = delete;
+  // The run time below which the given percentage of runs fell,
+  // interpolating between runs.
+  double get_percentile(double pct) const noexcept;
 
-  operator bool() const noexcept {
-    return ok;
+  double get_median() const noexcept {
+    return get_percentile(50);
   }
 
-  void fail() {
-    ok = false;
+  const std::vector<double> &get_secs() const noexcept {
+    return secs;
   }
 
-  const cfg_t &get_cfg() const noexcept {
-    return cfg;
-  }
+  // Writes the median and the shape of the distribution around it.
+  friend std::ostream &operator<<(
+      std::ostream &strm, const durations_t &that);
 
-  const fixture_t *get_fixture() const noexcept {
-    return fixture;
-  }
+private:
 
-  std::ostream &get_strm() const {
-    on_begin_show();
-    return cfg.get_strm();
-  }
+  std::vector<double> secs;
 
-  static ctxt_t *get_singleton() {
-    return singleton;
+  int warmup_cnt;
+
+};  // durations_t
+
+// Calls the callable 'warmup_cnt' times untimed, to fill caches and settle
+// branch predictors, then 'run_cnt' times timed.
+template <typename fn_t>
+durations_t time_runs(const fn_t &fn, int run_cnt = 31, int warmup_cnt = 3) {
+  using clock_t = std::chrono::steady_clock;
+  for (int i = 0; i < warmup_cnt; ++i) {
+    fn();
+    clobber_memory();
   }
+  std::vector<double> secs;
+  secs.reserve(static_cast<std::size_t>((run_cnt > 1) ? run_cnt : 1));
+  do {
+    auto start_time = clock_t::now();
+    fn();
+    clobber_memory();
+    secs.push_back(as_secs(clock_t::now() - start_time));
+  } while (static_cast<int>(secs.size()) < run_cnt);
+  return durations_t { std::move(secs), warmup_cnt };
+}
 
-private:
+// The kinds of event which lick can count with perf_event_open().
+enum class event_t {
+  cycles, instrs, branch_misses, l1d_misses, llc_misses, ctx_switches
+};
 
-  void on_begin_show() const;
+constexpr std::size_t event_cnt = 6;
 
-  void on_end_show() const;
+// Writes the event's name as perf spells it, such as "branch-misses".
+std::ostream &operator<<(std::ostream &strm, event_t event);
 
-  const fixture_t *fixture;
+// Counts of events over a stretch of code on one thread.
+class counters_t final {
+public:
 
-  const cfg_t &cfg;
+  // Whether the event was counted.  An event goes uncounted when the system
+  // won't count it, for instance in a container without permission to use
+  // hardware counters, or under a virtual machine without them.
+  bool has(event_t event) const noexcept {
+    return counted && vals[static_cast<std::size_t>(event)] >= 0;
+  }
 
-  mutable bool showing;
+  long long get(event_t event) const noexcept {
+    return vals[static_cast<std::size_t>(event)];
+  }
 
-  bool ok;
+  // The count divided by the number of operations counted over.
+  double get_per_op(event_t event) const noexcept {
+    return static_cast<double>(get(event))
+        / static_cast<double>((op_cnt > 1) ? op_cnt : 1);
+  }
 
-  static thread_local ctxt_t *singleton;
+  // Writes the events counted, per operation if there were many.
+  friend std::ostream &operator<<(
+      std::ostream &strm, const counters_t &that);
 
-};  // ctxt_t
+  // Whether there was any attempt to count.
+  bool counted;
 
-inline std::ostream &strm() noexcept {
-  return ctxt_t::get_singleton()->get_strm();
-}
+  // The number of operations over which the events were counted.
+  long long op_cnt;
 
-class fixture_t final {
+  // The counts, by event, or -1 where the event went uncounted.
+  long long vals[event_cnt];
+
+};  // counters_t
+
+// Counts events on the calling thread, from start() until stop().  Counters
+// may nest.
+class event_counter_t final {
 public:
 
-  using cb_t = std::function<bool (const fixture_t &)>;
-  using fn_t = void (*)();
+  // Starts counting unless told not to.
+  explicit event_counter_t(bool starts = true);
 
-  fixture_t(const loc_t &loc, const char *name, fn_t fn);
+  event_counter_t(const event_counter_t &) = delete;
 
-  fixture_t(const fixture_t &) = delete;
+  event_counter_t &operator=(const event_counter_t &) = delete;
 
-  fixture_t &operator=(const fixture_t &) = delete;
+  void start();
 
-  bool operator()(const cfg_t &cfg) const;
+  // Stops counting and returns the counts, to be divided among the given
+  // number of operations.
+  counters_t stop(long long op_cnt = 1);
 
-  const loc_t &get_loc() const noexcept {
-    return loc;
-  }
+private:
 
-  const char *get_name() const noexcept {
-    return name;
-  }
+  // The raw readings of each event at the start: the count, and the times
+  // for which the event was enabled and actually running, which differ
+  // when the kernel multiplexes too many events onto the hardware.
+  long long start_vals[event_cnt], start_enabled[event_cnt],
+      start_running[event_cnt];
+
+};  // event_counter_t
+
+// Counts the events while calling the callable once.  The callable should
+// perform 'op_cnt' operations, if per-op counts are wanted.
+template <typename fn_t>
+counters_t count_events(const fn_t &fn, long long op_cnt = 1) {
+  event_counter_t counter;
+  fn();
+  clobber_memory();
+  return counter.stop(op_cnt);
+}
 
-  static bool for_each(const cb_t &cb);
+class baseline_t;
 
-private:
+class fixture_t;
 
-  loc_t loc;
+class outcome_t;
 
-  const char *name;
+// The counts at the end of a run.
+class summary_t final {
+public:
 
-  fn_t fn;
+  // Fixtures skipped because they passed last time, per the result cache,
+  // aren't among the skipped ones but have their own count.
+  int pass_cnt, fail_cnt, skip_cnt, cache_cnt;
 
-  fixture_t *next;
+  bool ok;
 
-  static fixture_t *first, *last;
+  // The run's wall-clock time, in seconds.
+  double elapsed;
 
-};  // fixture_t
+};  // summary_t
 
-class any_operand_t {
+// Receives the results of a run as they become known.  A reporter hears about
+// the fixtures in the order in which they're defined, whether or not they
+// ran in that order, and only from the thread which called run_fixtures().
+class reporter_t {
 public:
 
-  virtual ~any_operand_t();
+  reporter_t(const reporter_t &) = delete;
 
-  any_operand_t(const any_operand_t &) = delete;
+  virtual ~reporter_t();
 
-  any_operand_t &operator=(const any_operand_t &) = delete;
+  reporter_t &operator=(const reporter_t &) = delete;
 
-  const char *get_src() const noexcept {
-    return src;
-  }
+  // Called once, before any fixture.
+  virtual void on_begin_run() = 0;
 
-  void write_src(std::ostream &strm) const {
-    strm << src;
-  }
+  // Called once for each fixture which ran.
+  virtual void on_fixture(
+      const fixture_t &fixture, const outcome_t &outcome) = 0;
 
-  virtual void write_val(std::ostream &strm) const = 0;
+  // Called once, after all the fixtures.
+  virtual void on_end_run(const summary_t &summary) = 0;
 
 protected:
 
-  any_operand_t(const char *src_)
-      : src(src_) {}
+  reporter_t() = default;
 
-private:
+};  // reporter_t
 
-  const char *src;
+// Writes a JUnit XML document, one testcase element per fixture as each is
+// reported.
+class junit_reporter_t final
+    : public reporter_t {
+public:
 
-};  // any_operand_t
+  explicit junit_reporter_t(std::shared_ptr<std::ostream> strm);
 
-writer_t<any_operand_t> src_of(const any_operand_t &operand);
+  virtual void on_begin_run() override;
 
-inline writer_t<any_operand_t> src_of(const any_operand_t &operand) {
-  return { operand, &any_operand_t::write_src };
-}
+  virtual void on_fixture(
+      const fixture_t &fixture, const outcome_t &outcome) override;
 
-writer_t<any_operand_t> val_of(const any_operand_t &operand);
+  virtual void on_end_run(const summary_t &summary) override;
 
-inline writer_t<any_operand_t> val_of(const any_operand_t &operand) {
-  return { operand, &any_operand_t::write_val };
-}
+private:
 
-template <typename val_t>
-class operand_t final
-    : public any_operand_t {
+  std::shared_ptr<std::ostream> strm;
+
+};  // junit_reporter_t
+
+// Writes one JSON object per line: a "begin" record, a "fixture" record for
+// each fixture as it's reported, and an "end" record with the summary.
+class json_reporter_t final
+    : public reporter_t {
 public:
 
-  operand_t(const char *src, const val_t &val_)
-      : any_operand_t(src), val(val_) {}
+  explicit json_reporter_t(std::shared_ptr<std::ostream> strm);
 
-  virtual void write_val(std::ostream &strm) const override {
-    write(strm, val);
-  }
+  virtual void on_begin_run() override;
 
-  const val_t &val;
+  virtual void on_fixture(
+      const fixture_t &fixture, const outcome_t &outcome) override;
 
-};  // operand_t<val_t>
+  virtual void on_end_run(const summary_t &summary) override;
 
-template <typename val_t>
-operand_t<val_t> as_operand(const char *src, const val_t &val) {
-  return { src, val };
-}
+private:
 
-class predicate_t {
+  std::shared_ptr<std::ostream> strm;
+
+};  // json_reporter_t
+
+// Chooses which fixtures run, according to a spec of terms separated by
+// spaces or commas.  A term is a fixture name, a glob in which '*' matches
+// any run of characters and '?' any one character, or a tag prefixed with
+// '@'.  A term prefixed with '!' excludes the fixtures it matches.  A
+// fixture is chosen if it matches any term which isn't an exclusion, or if
+// there are no such terms, and matches no exclusion.
+//
+// The spec is compiled once.  Names are looked up in a hash set, globs are
+// filed in a trie under the literal text before their first wildcard, so
+// that a fixture's name meets only the globs whose prefix it shares, and
+// tags are numbered so that each term's tags make a bitset.
+class selector_t final {
 public:
 
-  using cb_t = std::function<bool (const any_operand_t &)>;
+  // Chooses every fixture.
+  selector_t();
 
-  predicate_t(const predicate_t &) = delete;
+  // Throws std::invalid_argument if the spec has an empty term.
+  explicit selector_t(const std::string &spec);
 
-  virtual ~predicate_t();
+  selector_t(const selector_t &) = default;
 
-  predicate_t &operator=(const predicate_t &) = delete;
+  selector_t &operator=(const selector_t &) = default;
 
-  operator bool() const noexcept {
-    return ok;
-  }
+  bool matches(const fixture_t &fixture) const;
 
-  virtual const char *get_name() const = 0;
+private:
 
-  virtual bool for_each_operand(const cb_t &cb) const = 0;
+  // A node of a trie of glob prefixes.
+  class node_t final {
+  public:
 
-  void write_src(std::ostream &strm) const;
+    // The child nodes, each with the character which leads to it.
+    std::vector<std::pair<char, std::size_t>> kids;
 
-protected:
+    // The globs whose prefix ends here, as indices into terms_t::globs.
+    std::vector<std::size_t> globs;
 
-  explicit predicate_t(bool ok_)
-      : ok(ok_) {}
+  };  // node_t
 
-private:
+  // The terms which choose fixtures, or those which exclude them.
+  class terms_t final {
+  public:
 
-  bool ok;
+    terms_t();
 
-};  // predicate_t
+    bool is_empty() const noexcept;
 
-writer_t<predicate_t> src_of(const predicate_t &predicate);
+    void add_glob(const std::string &glob);
 
-inline writer_t<predicate_t> src_of(const predicate_t &predicate) {
-  return { predicate, &predicate_t::write_src };
-}
+    void add_tag(std::size_t tag_idx);
 
-class unary_t
-    : public predicate_t {
-public:
+    // Whether the name matches one of the names or globs.
+    bool matches_name(const char *name) const;
 
-  virtual bool for_each_operand(const cb_t &cb) const override final;
+    // Whether the numbered tag is one of the tags.
+    bool has_tag(std::size_t tag_idx) const noexcept {
+      auto word = tag_idx / 64;
+      return word < tag_bits.size()
+          && ((tag_bits[word] >> (tag_idx % 64)) & 1);
+    }
 
-protected:
+    std::unordered_set<std::string> names;
 
-  unary_t(bool ok, const any_operand_t &operand_)
-      : predicate_t(ok), operand(operand_) {}
+    // The trie, with the root first, and the rest of each glob after its
+    // literal prefix.
+    std::vector<node_t> nodes;
 
-private:
+    std::vector<std::string> globs;
 
-  const any_operand_t &operand;
+    std::vector<std::uint64_t> tag_bits;
+
+  };  // terms_t
+
+  // Whether the fixture has a tag among those of the terms.
+  bool has_tag(const fixture_t &fixture, const terms_t &terms) const;
+
+  // The tags named in the spec, numbered from 0.
+  std::unordered_map<std::string, std::size_t> tag_idxs;
+
+  terms_t includes, excludes;
+
+};  // selector_t
+
+class cfg_t final {
+public:
+
+  cfg_t();
+
+  cfg_t(const cfg_t &) = default;
+
+  cfg_t &operator=(const cfg_t &) = default;
+
+  // The benchmark results to compare against, or null for none.
+  const baseline_t *get_baseline() const noexcept {
+    return baseline.get();
+  }
+
+  // The path to which to save benchmark results, or empty for none.
+  const std::string &get_save_baseline_path() const noexcept {
+    return save_baseline_path;
+  }
+
+  // How much slower than its baseline, as a fraction, a benchmark must be
+  // before it counts as a regression.
+  double get_regression_threshold() const noexcept {
+    return regression_threshold;
+  }
+
+  // The target run time, in seconds, of each benchmark.
+  double get_bench_time() const noexcept {
+    return bench_time;
+  }
+
+  const selector_t &get_selector() const noexcept {
+    return selector;
+  }
+
+  std::ostream &get_strm() const noexcept {
+    return *strm;
+  }
+
+  const std::vector<std::shared_ptr<reporter_t>> &get_reporters()
+      const noexcept {
+    return reporters;
+  }
+
+  int get_fork_batch() const noexcept {
+    return fork_batch;
+  }
+
+  // The path of the result-cache file, or empty for none.
+  const std::string &get_cache_path() const noexcept {
+    return cache_path;
+  }
+
+  // The path of the timing-history file, or empty for none.
+  const std::string &get_history_path() const noexcept {
+    return history_path;
+  }
+
+  int get_jobs() const noexcept {
+    return jobs;
+  }
+
+  // The number of random cases to run of each property.
+  int get_case_cnt() const noexcept {
+    return case_cnt;
+  }
+
+  // The seed from which each property makes its cases.
+  std::uint64_t get_seed() const noexcept {
+    return seed;
+  }
+
+  // The number of seconds a fixture may run, or 0 for no limit.
+  double get_timeout() const noexcept {
+    return timeout;
+  }
+
+  // The number of slowest fixtures to list after the summary.
+  int get_slow_cnt() const noexcept {
+    return slow_cnt;
+  }
+
+  // The shard to run, counting from 0, and the number of shards.  With one
+  // shard, the default, every fixture runs.
+  int get_shard_idx() const noexcept {
+    return shard_idx;
+  }
+
+  int get_shard_cnt() const noexcept {
+    return shard_cnt;
+  }
+
+  bool is_strict() const noexcept {
+    return strict;
+  }
+
+  // Whether to count hardware and software events for each fixture.
+  bool counts_events() const noexcept {
+    return events;
+  }
+
+  // Whether to count each fixture's allocations.
+  bool tracks_allocs() const noexcept {
+    return allocs || leaks;
+  }
+
+  // Whether a fixture fails if it ends with allocations still live.
+  bool fails_leaks() const noexcept {
+    return leaks;
+  }
+
+  // Whether to run every fixture, even those the result cache would skip.
+  bool is_forced() const noexcept {
+    return forced;
+  }
+
+  // Whether resources outlive the run rather than being torn down after
+  // their last users, as for a driver which runs the fixtures again and
+  // again.
+  bool keeps_resources() const noexcept {
+    return keeps;
+  }
+
+  bool runs_benches() const noexcept {
+    return benches;
+  }
+
+  bool runs_tests() const noexcept {
+    return tests;
+  }
+
+  int get_verbosity() const noexcept {
+    return verbosity;
+  }
+
+  void add_reporter(std::shared_ptr<reporter_t> reporter) {
+    reporters.push_back(std::move(reporter));
+  }
+
+  void set_events(bool events_) {
+    events = events_;
+  }
+
+  void set_allocs(bool allocs_) {
+    allocs = allocs_;
+  }
+
+  void set_leaks(bool leaks_) {
+    leaks = leaks_;
+  }
+
+  void set_baseline(std::shared_ptr<const baseline_t> baseline_) {
+    baseline = std::move(baseline_);
+  }
+
+  void set_save_baseline_path(std::string save_baseline_path_) {
+    save_baseline_path = std::move(save_baseline_path_);
+  }
+
+  void set_regression_threshold(double regression_threshold_) {
+    regression_threshold =
+        (regression_threshold_ > 0) ? regression_threshold_ : 0;
+  }
+
+  void set_bench_time(double bench_time_) {
+    bench_time = (bench_time_ > 0) ? bench_time_ : 0;
+  }
+
+  void set_case_cnt(int case_cnt_) {
+    case_cnt = (case_cnt_ < 1) ? 1 : case_cnt_;
+  }
+
+  void set_cache_path(std::string cache_path_) {
+    cache_path = std::move(cache_path_);
+  }
+
+  void set_forced(bool forced_) {
+    forced = forced_;
+  }
+
+  void set_fork_batch(int fork_batch_) {
+    fork_batch = (fork_batch_ < 0) ? 0 : fork_batch_;
+  }
+
+  void set_history_path(std::string history_path_) {
+    history_path = std::move(history_path_);
+  }
+
+  void set_jobs(int jobs_) {
+    jobs = (jobs_ < 1) ? 1 : jobs_;
+  }
+
+  void set_keeps_resources(bool keeps_) {
+    keeps = keeps_;
+  }
+
+  void set_slow_cnt(int slow_cnt_) {
+    slow_cnt = (slow_cnt_ < 0) ? 0 : slow_cnt_;
+  }
+
+  // Returns false, changing nothing, if the shard is not one of the shards.
+  bool set_shard(int shard_idx_, int shard_cnt_) {
+    if (shard_cnt_ < 1 || shard_idx_ < 0 || shard_idx_ >= shard_cnt_) {
+      return false;
+    }
+    shard_idx = shard_idx_;
+    shard_cnt = shard_cnt_;
+    return true;
+  }
+
+  void set_seed(std::uint64_t seed_) {
+    seed = seed_;
+  }
+
+  void set_selector(selector_t selector_) {
+    selector = std::move(selector_);
+  }
+
+  void set_strm(std::ostream &strm_) {
+    strm = &strm_;
+  }
+
+  void set_timeout(double timeout_) {
+    timeout = (timeout_ > 0) ? timeout_ : 0;
+  }
+
+  void set_verbosity(int verbosity_) {
+    verbosity = (verbosity_ < 0) ? 0 : (verbosity_ > 2) ? 2 : verbosity_;
+  }
+
+  // Choose whether to run tests, benchmarks, or both.
+  void set_kinds(bool tests_, bool benches_) {
+    tests = tests_;
+    benches = benches_;
+  }
+
+  static bool parse(cfg_t &cfg, int argc, char *argv[]);
+
+private:
+
+  std::ostream *strm;
+
+  std::vector<std::shared_ptr<reporter_t>> reporters;
+
+  selector_t selector;
+
+  std::string cache_path, history_path, save_baseline_path;
+
+  std::shared_ptr<const baseline_t> baseline;
+
+  int verbosity;
+
+  int jobs;
+
+  int fork_batch;
+
+  int slow_cnt;
+
+  int case_cnt;
+
+  int shard_idx, shard_cnt;
+
+  std::uint64_t seed;
+
+  double bench_time, regression_threshold, timeout;
+
+  bool strict, forced, allocs, leaks, events, tests, benches, keeps;
+
+};  // cfg_t
+
+// Something noteworthy which happened during a fixture: an expectation which
+// was reported, or an exception, crash or timeout which ended the fixture.
+class note_t final {
+public:
+
+  // One of "expect", "exception", "crash" or "timeout".
+  const char *kind;
+
+  loc_t loc;
+
+  bool ok;
+
+  // The plain text of the note, without colors.
+  std::string msg;
+
+};  // note_t
+
+// What a fixture allocated with operator new, when allocations are tracked.
+class allocs_t final {
+public:
+
+  // The number and total size of the allocations.
+  std::size_t cnt, bytes;
+
+  // The most bytes live at once.
+  std::size_t peak_bytes;
+
+  // The number and total size of the allocations still live at the end.
+  std::size_t leak_cnt, leak_bytes;
+
+};  // allocs_t
+
+// What came of running a fixture.
+class outcome_t final {
+public:
+
+  bool ok;
+
+  // The fixture's run time, in seconds, by the monotonic clock and by the CPU
+  // time of the thread which ran it.
+  double wall, cpu;
+
+  // The noteworthy things, in the order in which they happened.  Passing
+  // expectations are among them only when passes are shown.
+  std::vector<note_t> notes;
+
+  // All zeros unless allocations are tracked.
+  allocs_t allocs;
+
+  // For a benchmark, the mean time per iteration, in nanoseconds, of each
+  // sample.
+  std::vector<double> samples;
+
+  // Not counted unless events are counted.  For a benchmark, the counts
+  // cover the timed samples and are per iteration.
+  counters_t counters;
+
+};  // outcome_t
+
+class ctxt_t final {
+public:
+
+  // Without a fixture, the context is that of a case of a property being
+  // tried quietly: it shows nothing, and tracks neither allocations nor
+  // events.
+  ctxt_t(const fixture_t *fixture, const cfg_t &cfg, std::ostream &strm);
+
+  ~ctxt_t();
+
+  ctxt_t(const ctxt_t &) = delete;
+
+  ctxt_t &operator=(const ctxt_t &) = delete;
+
+  operator bool() const noexcept {
+    return outcome.ok;
+  }
+
+  // Records a note, failing the fixture if the note is of a failure.
+  void add_note(note_t note);
+
+  void fail() {
+    outcome.ok = false;
+  }
+
+  void set_samples(std::vector<double> samples) {
+    outcome.samples = std::move(samples);
+  }
+
+  void set_counters(const counters_t &counters) {
+    outcome.counters = counters;
+  }
+
+  // Leaves time spent on something other than the fixture, such as building
+  // a resource, out of the fixture's own.
+  void exclude(double wall, double cpu) noexcept {
+    start_wall += wall;
+    start_cpu += cpu;
+  }
+
+  // Stops the fixture's clocks, if they haven't already been stopped, and
+  // returns its outcome.
+  const outcome_t &stop();
+
+  const cfg_t &get_cfg() const noexcept {
+    return cfg;
+  }
+
+  const fixture_t *get_fixture() const noexcept {
+    return fixture;
+  }
+
+  std::ostream &get_strm() const {
+    on_begin_show();
+    return strm;
+  }
+
+  static ctxt_t *get_singleton() {
+    return singleton;
+  }
+
+  // Lets other threads report to this context, each through a guest_t, and
+  // makes reporting safe for them.  Sends what's been written so far on its
+  // way, so that the threads' reports follow it.
+  void share();
+
+  // True if other threads may be reporting to this context, in which case a
+  // report must hold the lock.
+  bool is_shared() const noexcept {
+    return shared;
+  }
+
+  std::mutex &get_mutex() const noexcept {
+    return mutex;
+  }
+
+  // Makes a context that of the calling thread for the guest's lifetime, as
+  // for another thread reporting to a shared context, or for a coroutine
+  // fixture resuming on the loop, then restores the one it displaced.
+  class guest_t final {
+  public:
+
+    explicit guest_t(ctxt_t &ctxt) noexcept
+        : host(singleton) {
+      singleton = &ctxt;
+    }
+
+    guest_t(const guest_t &) = delete;
+
+    ~guest_t() {
+      singleton = host;
+    }
+
+    guest_t &operator=(const guest_t &) = delete;
+
+  private:
+
+    ctxt_t *host;
+
+  };  // guest_t
+
+  // True when the calling thread's context leaves passing expectations
+  // unreported, which is to say when the verbosity is below 2, or when the
+  // context is that of a property's case.
+  static bool hides_passes() noexcept {
+    return !singleton || singleton->quiet;
+  }
+
+  // True if any context may show passes, which is to say if the verbosity
+  // has been 2 or more.  Unlike hides_passes(), this is a plain flag, cheap
+  // enough to test on every expectation.
+  static bool may_show_passes() noexcept {
+    return shows_passes.load(std::memory_order_relaxed);
+  }
+
+private:
+
+  void on_begin_show() const;
+
+  void on_end_show() const;
+
+  const fixture_t *fixture;
+
+  const cfg_t &cfg;
+
+  std::ostream &strm;
+
+  mutable bool showing;
+
+  bool stopped;
+
+  // The times at which the fixture started.
+  double start_wall, start_cpu;
+
+  outcome_t outcome;
+
+  // Counts the events of a fixture other than a benchmark.
+  event_counter_t counter;
+
+  bool shared;
+
+  bool quiet;
+
+  mutable std::mutex mutex;
+
+  static thread_local ctxt_t *singleton;
+
+  static std::atomic<bool> shows_passes;
+
+};  // ctxt_t
+
+inline std::ostream &strm() noexcept {
+  return ctxt_t::get_singleton()->get_strm();
+}
+
+class resource_t;
+
+// How lick starts and drives the coroutine of a fixture declared by
+// ASYNC_FIXTURE.  The functions come from the fixture's own translation unit,
+// which is built as C++20, and know a coroutine by its address.
+struct async_fixture_t final {
+
+  // Makes the coroutine, suspended before its first statement.
+  void *(*start)();
+
+  void (*resume)(void *);
+
+  bool (*is_done)(void *);
+
+  // Destroys a coroutine which has finished, then rethrows whatever escaped
+  // it, if anything.
+  void (*finish)(void *);
+
+  // Destroys a coroutine which hasn't finished, as when it times out.
+  void (*destroy)(void *);
+
+};  // async_fixture_t
+
+// How lick enumerates and runs the rows of a fixture declared by FIXTURE_P.
+// The functions come from the fixture's own translation unit, and know a row
+// by its address in the table.  The rows become fixtures only when the
+// fixtures are first enumerated, not at static initialization, and aren't
+// copied, so a large table costs little until it runs.
+struct param_fixture_t final {
+
+  using row_cb_t = std::function<void (const void *)>;
+
+  // Calls back with the address of each row of the table, in order.
+  void (*for_each_row)(const row_cb_t &cb);
+
+  void (*run_row)(const void *row);
+
+};  // param_fixture_t
+
+// Suspends the coroutine at the given address on the calling thread's loop
+// until the given number of seconds have passed, then resumes it with the
+// given function.  Throws if no loop is running, which is to say outside a
+// coroutine fixture.  See sleep_for().
+void await_timer(double secs, void (*resume)(void *), void *addr);
+
+// As await_timer(), but until the file descriptor is ready to be read or
+// written.  Only one coroutine at a time may await a given descriptor.  See
+// readable() and writable().
+void await_fd(int fd, bool writing, void (*resume)(void *), void *addr);
+
+class fixture_t final {
+public:
+
+  using cb_t = std::function<bool (const fixture_t &)>;
+  using fn_t = void (*)();
+  using bench_fn_t = void (*)(state_t &);
+  using stress_fn_t = void (*)(std::size_t, std::uint64_t &);
+
+  // A timeout of 0 leaves the fixture to the --timeout option.  The tags are
+  // words separated by spaces or commas.
+  constexpr fixture_t(
+      const loc_t &loc_, const char *name_, fn_t fn_, double timeout_ = 0,
+      const char *tags_ = nullptr)
+      : loc(loc_), name(name_), tags(tags_), fn(fn_), bench_fn(nullptr),
+        stress_fn(nullptr), async(nullptr), param(nullptr),
+        resources(nullptr), row(nullptr), timeout(timeout_), thread_cnt(0) {}
+
+  // A test fixture which uses the given resources.  They're in a
+  // null-terminated array.
+  constexpr fixture_t(
+      const loc_t &loc_, const char *name_,
+      resource_t *const *resources_, fn_t fn_)
+      : loc(loc_), name(name_), tags(nullptr), fn(fn_), bench_fn(nullptr),
+        stress_fn(nullptr), async(nullptr), param(nullptr),
+        resources(resources_), row(nullptr), timeout(0), thread_cnt(0) {}
+
+  // A benchmark is a fixture whose function loops on a state_t.
+  constexpr fixture_t(
+      const loc_t &loc_, const char *name_, bench_fn_t bench_fn_)
+      : loc(loc_), name(name_), tags(nullptr), fn(nullptr),
+        bench_fn(bench_fn_), stress_fn(nullptr), async(nullptr),
+        param(nullptr), resources(nullptr), row(nullptr), timeout(0),
+        thread_cnt(0) {}
+
+  // A stress fixture, whose function runs on the given number of threads at
+  // once, each with its index and a count of the operations it does.
+  constexpr fixture_t(
+      const loc_t &loc_, const char *name_, stress_fn_t stress_fn_,
+      int thread_cnt_)
+      : loc(loc_), name(name_), tags(nullptr), fn(nullptr),
+        bench_fn(nullptr), stress_fn(stress_fn_), async(nullptr),
+        param(nullptr), resources(nullptr), row(nullptr), timeout(0),
+        thread_cnt(thread_cnt_) {}
+
+  // A coroutine fixture, which runs on the loop with the others.
+  constexpr fixture_t(
+      const loc_t &loc_, const char *name_, const async_fixture_t *async_)
+      : loc(loc_), name(name_), tags(nullptr), fn(nullptr),
+        bench_fn(nullptr), stress_fn(nullptr), async(async_),
+        param(nullptr), resources(nullptr), row(nullptr), timeout(0),
+        thread_cnt(0) {}
+
+  // Holds the place of a parameterized fixture among the others.  It isn't
+  // enumerated itself; its rows are, in its place.
+  constexpr fixture_t(
+      const loc_t &loc_, const char *name_, const param_fixture_t *param_)
+      : loc(loc_), name(name_), tags(nullptr), fn(nullptr),
+        bench_fn(nullptr), stress_fn(nullptr), async(nullptr),
+        param(param_), resources(nullptr), row(nullptr), timeout(0),
+        thread_cnt(0) {}
+
+  // A row of a parameterized fixture, which the place holder enumerates in
+  // its place.  The row is the address of the table's element.
+  fixture_t(const fixture_t &place, const void *row, const char *name);
+
+  fixture_t(const fixture_t &) = delete;
+
+  fixture_t &operator=(const fixture_t &) = delete;
+
+  bool operator()(const cfg_t &cfg) const {
+    return run(cfg, cfg.get_strm()).ok;
+  }
+
+  // Runs the fixture, writing its report to the given stream rather than to
+  // the one in the configuration.
+  outcome_t run(const cfg_t &cfg, std::ostream &strm) const;
+
+  const loc_t &get_loc() const noexcept {
+    return loc;
+  }
+
+  const char *get_name() const noexcept {
+    return name;
+  }
+
+  const char *get_tags() const noexcept {
+    return tags ? tags : "";
+  }
+
+  // The number of seconds the fixture may run, or 0 for no limit.
+  double get_timeout(const cfg_t &cfg) const noexcept {
+    return (timeout > 0) ? timeout : cfg.get_timeout();
+  }
+
+  bool is_bench() const noexcept {
+    return bench_fn != nullptr;
+  }
+
+  // Null unless this is a coroutine fixture.
+  const async_fixture_t *get_async() const noexcept {
+    return async;
+  }
+
+  // The resources the fixture uses, in a null-terminated array, or null if
+  // it uses none.
+  resource_t *const *get_resources() const noexcept {
+    return resources;
+  }
+
+  bool uses(const resource_t &resource) const noexcept;
+
+  // Ends a run of the fixture in the given context once its function has
+  // returned or thrown: reports the exception, if any, and the counters and
+  // leaks, if they're tracked.  Returns the outcome.
+  outcome_t conclude(ctxt_t &ctxt, const stalled_t<void> &stalled) const;
+
+  static bool for_each(const cb_t &cb);
+
+  // The records of the fixtures in one program or shared object, back to
+  // back, as the linker gathers them.
+  struct span_t final {
+
+    const fixture_t *start, *stop;
+
+  };  // span_t
+
+  // Makes for_each() enumerate the fixtures in the given spans, in order, in
+  // place of the program's own, as for a driver which loads its fixtures
+  // from shared objects.  Not thread-safe.
+  static void set_records(const std::vector<span_t> &spans);
+
+private:
+
+  // The rows of the given place holder as fixtures, named like "name/17",
+  // made the first time this is called for it.  Not thread-safe.
+  static const std::deque<fixture_t> &get_rows(const fixture_t &place);
+
+  void run_bench(ctxt_t &ctxt) const;
+
+  void run_stress(ctxt_t &ctxt) const;
+
+  void run_async(ctxt_t &ctxt) const;
+
+  loc_t loc;
+
+  // The tags are null if there are none, which spares the loader from
+  // relocating a pointer to an empty string in every record.
+  const char *name, *tags;
+
+  fn_t fn;
+
+  bench_fn_t bench_fn;
+
+  stress_fn_t stress_fn;
+
+  const async_fixture_t *async;
+
+  // The parameterized fixture of which this is a row, or its place holder,
+  // and the address of the row.
+  const param_fixture_t *param;
+
+  resource_t *const *resources;
+
+  const void *row;
+
+  double timeout;
+
+  // The number of threads on which a stress fixture runs.
+  int thread_cnt;
+
+};  // fixture_t
+
+#if !defined(LICK_FIXTURE_SECTION)
+// Adds the fixture to those which for_each() enumerates.
+void enroll_fixture(const fixture_t &fixture);
+
+// The record of a fixture where the linker can't gather the records, which
+// enrolls its fixture when it's constructed.
+class enrolled_fixture_t final {
+public:
+
+  template <typename... args_t>
+  enrolled_fixture_t(args_t &&... args)
+      : fixture(std::forward<args_t>(args)...) {
+    enroll_fixture(fixture);
+  }
+
+  enrolled_fixture_t(const enrolled_fixture_t &) = delete;
+
+  enrolled_fixture_t &operator=(const enrolled_fixture_t &) = delete;
+
+private:
+
+  fixture_t fixture;
+
+};  // enrolled_fixture_t
+#endif
+
+// The type of a row of a table.
+template <typename table_t>
+using row_of_t = typename std::decay<
+    decltype(*std::begin(std::declval<const table_t &>()))>::type;
+
+// Calls back with the address of each row of a table, in order.  The rows are
+// found again by address, rather than by stepping to each one from the
+// beginning, so that a table without random access, such as a list, costs as
+// little per row as an array.
+template <typename table_t>
+void for_each_row(const table_t &table, const param_fixture_t::row_cb_t &cb) {
+  static_assert(
+      std::is_lvalue_reference<decltype(*std::begin(table))>::value,
+      "a table's rows must be objects in the table, not proxies");
+  for (const auto &row : table) {
+    cb(&row);
+  }  // for
+}
+
+// A resource shared by fixtures, declared by RESOURCE.  The runner counts the
+// fixtures chosen to run which use each resource, and the resource is torn
+// down when the last of them is done.
+class resource_t {
+public:
+
+  resource_t(const resource_t &) = delete;
+
+  virtual ~resource_t();
+
+  resource_t &operator=(const resource_t &) = delete;
+
+  const char *get_name() const noexcept {
+    return name;
+  }
+
+  // Counts another fixture chosen to run which uses the resource.
+  void add_user() noexcept {
+    user_cnt.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Called when a fixture which uses the resource is done.  Tears the
+  // resource down if that was the last of its users.
+  void drop_user() noexcept;
+
+protected:
+
+  constexpr explicit resource_t(const char *name_) noexcept
+      : name(name_), built(false), user_cnt(0) {}
+
+  // Builds the resource for the calling fixture, if it isn't built already,
+  // leaving the time this takes out of the fixture's own, and reporting it
+  // apart.  Throws if the fixture doesn't use the resource, or if building
+  // fails, in which case the next fixture to ask tries again.
+  void acquire();
+
+  virtual void build() = 0;
+
+  virtual void tear_down() noexcept = 0;
+
+private:
+
+  const char *name;
+
+  std::atomic<bool> built;
+
+  std::atomic<int> user_cnt;
+
+  // Held while building or tearing down.
+  std::mutex mutex;
+
+};  // resource_t
+
+// A resource of a particular type.
+template <typename val_t>
+class resource_of_t final
+    : public resource_t {
+public:
+
+  using build_fn_t = val_t (*)();
+
+  constexpr resource_of_t(const char *name_, build_fn_t build_fn_) noexcept
+      : resource_t(name_), build_fn(build_fn_) {}
+
+  // Builds the value, if need be, and returns it.
+  const val_t &get() {
+    acquire();
+    return *val;
+  }
+
+private:
+
+  virtual void build() override {
+    val.reset(new val_t(build_fn()));
+  }
+
+  virtual void tear_down() noexcept override {
+    val.reset();
+  }
+
+  build_fn_t build_fn;
+
+  std::unique_ptr<val_t> val;
+
+};  // resource_of_t<val_t>
+
+// What a fixture knows a resource by: a constant which reaches the value as
+// through a pointer to const.  It converts to a pointer to the resource, so
+// that FIXTURE_USING can list it.
+template <typename val_t>
+class resource_ref_t final {
+public:
+
+  constexpr explicit resource_ref_t(resource_of_t<val_t> *resource_) noexcept
+      : resource(resource_) {}
+
+  constexpr operator resource_t *() const noexcept {
+    return resource;
+  }
+
+  const val_t &operator*() const {
+    return resource->get();
+  }
+
+  const val_t *operator->() const {
+    return &resource->get();
+  }
+
+private:
+
+  resource_of_t<val_t> *resource;
+
+};  // resource_ref_t<val_t>
+
+#if defined(LICK_HAS_COROUTINES)
+
+// The coroutine of a fixture declared by ASYNC_FIXTURE, or of a function
+// which such a fixture awaits.  It starts suspended and runs when awaited,
+// and when it finishes it resumes its awaiter, if any.  An exception which
+// escapes it is rethrown to its awaiter.
+class task_t final {
+public:
+
+  class promise_type final {
+  public:
+
+    task_t get_return_object() noexcept {
+      return task_t { handle_t::from_promise(*this) };
+    }
+
+    std::suspend_always initial_suspend() const noexcept {
+      return {};
+    }
+
+    // Passes control straight to the awaiter, if any.  A fixture's own
+    // coroutine has none, so it stays suspended for lick to find it done.
+    auto final_suspend() const noexcept {
+      struct final_awaiter_t final {
+
+        bool await_ready() const noexcept {
+          return false;
+        }
+
+        std::coroutine_handle<> await_suspend(handle_t handle) noexcept {
+          auto awaiter = handle.promise().awaiter;
+          return awaiter ? awaiter : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+
+      };  // final_awaiter_t
+      return final_awaiter_t {};
+    }
+
+    void return_void() const noexcept {}
+
+    void unhandled_exception() noexcept {
+      ex = std::current_exception();
+    }
+
+  private:
+
+    friend class task_t;
+
+    std::coroutine_handle<> awaiter;
+
+    std::exception_ptr ex;
+
+  };  // promise_type
+
+  task_t(task_t &&that) noexcept
+      : handle(std::exchange(that.handle, nullptr)) {}
+
+  task_t(const task_t &) = delete;
+
+  ~task_t() {
+    if (handle) {
+      handle.destroy();
+    }
+  }
+
+  task_t &operator=(task_t &&) = delete;
+
+  task_t &operator=(const task_t &) = delete;
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<> awaiter) noexcept {
+    handle.promise().awaiter = awaiter;
+    return handle;
+  }
+
+  void await_resume() const {
+    if (handle.promise().ex) {
+      std::rethrow_exception(handle.promise().ex);
+    }
+  }
+
+  // Gives up the coroutine, returning its address, for lick to drive.
+  void *release() noexcept {
+    return std::exchange(handle, nullptr).address();
+  }
+
+  // The functions by which lick drives a released coroutine.  See
+  // async_fixture_t.
+
+  static void resume(void *addr) {
+    std::coroutine_handle<>::from_address(addr).resume();
+  }
+
+  static bool is_done(void *addr) {
+    return std::coroutine_handle<>::from_address(addr).done();
+  }
+
+  static void finish(void *addr) {
+    auto handle = handle_t::from_address(addr);
+    auto ex = std::move(handle.promise().ex);
+    handle.destroy();
+    if (ex) {
+      std::rethrow_exception(ex);
+    }
+  }
+
+  static void destroy(void *addr) {
+    std::coroutine_handle<>::from_address(addr).destroy();
+  }
+
+private:
+
+  using handle_t = std::coroutine_handle<promise_type>;
+
+  explicit task_t(handle_t handle_) noexcept
+      : handle(handle_) {}
+
+  handle_t handle;
+
+};  // task_t
+
+// Suspends a coroutine fixture on the loop for a number of seconds.  See
+// sleep_for().
+class sleep_t final {
+public:
+
+  explicit sleep_t(double secs_) noexcept
+      : secs(secs_) {}
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  void await_suspend(std::coroutine_handle<> handle) const {
+    await_timer(secs, task_t::resume, handle.address());
+  }
+
+  void await_resume() const noexcept {}
+
+private:
+
+  double secs;
+
+};  // sleep_t
+
+// Suspends a coroutine fixture on the loop until a file descriptor is ready.
+// See readable() and writable().
+class fd_wait_t final {
+public:
+
+  fd_wait_t(int fd_, bool writing_) noexcept
+      : fd(fd_), writing(writing_) {}
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  void await_suspend(std::coroutine_handle<> handle) const {
+    await_fd(fd, writing, task_t::resume, handle.address());
+  }
+
+  void await_resume() const noexcept {}
+
+private:
+
+  int fd;
+
+  bool writing;
+
+};  // fd_wait_t
+
+// Awaits the passing of the given number of seconds, like this:
+//   co_await lick::sleep_for(0.05);
+// The other fixtures on the loop run in the meantime.  Zero seconds just
+// lets them run.
+inline sleep_t sleep_for(double secs) noexcept {
+  return sleep_t { secs };
+}
+
+// Awaits the file descriptor's being ready to read, or at its end or in
+// error.  A regular file is always ready.
+inline fd_wait_t readable(int fd) noexcept {
+  return fd_wait_t { fd, false };
+}
+
+// Awaits the file descriptor's being ready to write, or in error.
+inline fd_wait_t writable(int fd) noexcept {
+  return fd_wait_t { fd, true };
+}
+
+#endif
+
+class any_operand_t {
+public:
+
+  virtual ~any_operand_t();
+
+  any_operand_t(const any_operand_t &) = delete;
+
+  any_operand_t &operator=(const any_operand_t &) = delete;
+
+  const char *get_src() const noexcept {
+    return src;
+  }
+
+  void write_src(std::ostream &strm) const {
+    strm << src;
+  }
+
+  virtual void write_val(std::ostream &strm) const = 0;
+
+protected:
+
+  any_operand_t(const char *src_)
+      : src(src_) {}
+
+private:
+
+  const char *src;
+
+};  // any_operand_t
+
+writer_t<any_operand_t> src_of(const any_operand_t &operand);
+
+inline writer_t<any_operand_t> src_of(const any_operand_t &operand) {
+  return { operand, &any_operand_t::write_src };
+}
+
+writer_t<any_operand_t> val_of(const any_operand_t &operand);
+
+inline writer_t<any_operand_t> val_of(const any_operand_t &operand) {
+  return { operand, &any_operand_t::write_val };
+}
+
+// An operand of an expectation, as captured by the EXPECT macros: its source
+// text and a reference to its value.  Capturing one costs nothing beyond the
+// two pointers.
+template <typename val_t>
+class operand_t final {
+public:
+
+  operand_t(const char *src_, const val_t &val_)
+      : src(src_), val(val_) {}
+
+  const char *src;
+
+  const val_t &val;
+
+};  // operand_t<val_t>
+
+template <typename val_t>
+operand_t<val_t> as_operand(const char *src, const val_t &val) {
+  return { src, val };
+}
+
+// Presents an operand_t<val_t> as an any_operand_t.  Built only when an
+// expectation is to be reported.
+template <typename val_t>
+class typed_operand_t final
+    : public any_operand_t {
+public:
+
+  explicit typed_operand_t(const operand_t<val_t> &operand)
+      : any_operand_t(operand.src), val(operand.val) {}
+
+  virtual void write_val(std::ostream &strm) const override {
+    write(strm, val);
+  }
+
+  const val_t &val;
+
+};  // typed_operand_t<val_t>
+
+// Promotes character types, so that they're written as numbers, and leaves
+// other types alone.
+template <typename val_t>
+auto as_number(const val_t &val) -> typename std::enable_if<
+    std::is_arithmetic<val_t>::value, decltype(+val)>::type {
+  return +val;
+}
+
+template <typename val_t>
+auto as_number(const val_t &val) -> typename std::enable_if<
+    !std::is_arithmetic<val_t>::value, const val_t &>::type {
+  return val;
+}
+
+// A view of a contiguous run of values, as the EXPECT_RANGE macros capture
+// them.  It doesn't own the values.
+template <typename elem_t>
+class span_t final {
+public:
+
+  span_t(const elem_t *data_, std::size_t size_) noexcept
+      : data(data_), size(size_) {}
+
+  const elem_t &operator[](std::size_t idx) const noexcept {
+    return data[idx];
+  }
+
+  const elem_t *get_data() const noexcept {
+    return data;
+  }
+
+  std::size_t get_size() const noexcept {
+    return size;
+  }
+
+  // Writes the first few values and, if there are more, how many in all.
+  friend std::ostream &operator<<(std::ostream &strm, const span_t &that) {
+    static constexpr std::size_t max_shown = 4;
+    strm << '{';
+    for (std::size_t idx = 0; idx < that.size && idx < max_shown; ++idx) {
+      strm << (idx ? ", " : " ") << as_number(that.data[idx]);
+    }
+    if (that.size > max_shown) {
+      strm << ", ... } (" << that.size << " values)";
+    } else {
+      strm << (that.size ? " }" : "}");
+    }
+    return strm;
+  }
+
+private:
+
+  const elem_t *data;
+
+  std::size_t size;
+
+};  // span_t<elem_t>
+
+template <typename elem_t>
+span_t<elem_t> as_span(const elem_t *data, std::size_t size) noexcept {
+  return { data, size };
+}
+
+template <typename elem_t, std::size_t size>
+span_t<elem_t> as_span(const elem_t (&data)[size]) noexcept {
+  return { data, size };
+}
+
+template <typename elem_t>
+span_t<elem_t> as_span(const span_t<elem_t> &span) noexcept {
+  return span;
+}
+
+// Any container with contiguous storage, such as std::vector or std::array.
+template <typename container_t>
+auto as_span(const container_t &container) noexcept
+    -> span_t<typename std::remove_const<
+        typename std::remove_pointer<decltype(container.data())>::type>::type> {
+  return { container.data(), container.size() };
+}
+
+// The element-wise comparisons of the EXPECT_RANGE macros.
+enum class range_op_t { eq, lt, le, gt, ge };
+
+// The types of values which the range kernels handle.  Integers are handled
+// by their size and signedness, whatever their type.
+enum class elem_kind_t { none, s8, u8, s16, u16, s32, u32, s64, u64, f32, f64 };
+
+template <typename elem_t>
+constexpr elem_kind_t get_elem_kind() noexcept {
+  return std::is_same<elem_t, float>::value ? elem_kind_t::f32
+      : std::is_same<elem_t, double>::value ? elem_kind_t::f64
+      : !std::is_integral<elem_t>::value ? elem_kind_t::none
+      : (sizeof(elem_t) == 1)
+      ? (std::is_signed<elem_t>::value ? elem_kind_t::s8 : elem_kind_t::u8)
+      : (sizeof(elem_t) == 2)
+      ? (std::is_signed<elem_t>::value ? elem_kind_t::s16 : elem_kind_t::u16)
+      : (sizeof(elem_t) == 4)
+      ? (std::is_signed<elem_t>::value ? elem_kind_t::s32 : elem_kind_t::u32)
+      : (sizeof(elem_t) == 8)
+      ? (std::is_signed<elem_t>::value ? elem_kind_t::s64 : elem_kind_t::u64)
+      : elem_kind_t::none;
+}
+
+// Counts the indices in [0, size) at which lhs[idx] doesn't compare to
+// rhs[idx] as the op says.  The kernels use AVX2 or SSE2, whichever the CPU
+// has, or plain C++ where neither is available.
+std::size_t count_range_misses(
+    range_op_t op, elem_kind_t kind, const void *lhs, const void *rhs,
+    std::size_t size) noexcept;
+
+template <range_op_t op, typename elem_t>
+bool test_range_elem(const elem_t &lhs, const elem_t &rhs) {
+  switch (op) {
+    case range_op_t::eq: {
+      return lhs == rhs;
+    }
+    case range_op_t::lt: {
+      return lhs < rhs;
+    }
+    case range_op_t::le: {
+      return lhs <= rhs;
+    }
+    case range_op_t::gt: {
+      return lhs > rhs;
+    }
+    case range_op_t::ge: {
+      return lhs >= rhs;
+    }
+  }
+  return false;
+}
+
+// Counts the misses among the values the two spans have in common.
+template <range_op_t op, typename elem_t>
+std::size_t count_range_misses(
+    const span_t<elem_t> &lhs, const span_t<elem_t> &rhs) {
+  auto size = std::min(lhs.get_size(), rhs.get_size());
+  static constexpr auto kind = get_elem_kind<elem_t>();
+  if (kind != elem_kind_t::none) {
+    return count_range_misses(
+        op, kind, lhs.get_data(), rhs.get_data(), size);
+  }
+  std::size_t miss_cnt = 0;
+  for (std::size_t idx = 0; idx < size; ++idx) {
+    miss_cnt += !test_range_elem<op>(lhs[idx], rhs[idx]);
+  }
+  return miss_cnt;
+}
+
+// Describes how two spans fail to compare: whether their sizes differ, how
+// many values miss, and the first few misses, each with its index and
+// values.
+template <range_op_t op, typename elem_t>
+std::string describe_range_misses(
+    const span_t<elem_t> &lhs, const span_t<elem_t> &rhs) {
+  static constexpr std::size_t max_shown = 8;
+  std::ostringstream strm;
+  if (lhs.get_size() != rhs.get_size()) {
+    strm
+        << separator << "sizes differ, "
+        << lhs.get_size() << " vs " << rhs.get_size();
+  }
+  auto miss_cnt = count_range_misses<op>(lhs, rhs);
+  if (!miss_cnt) {
+    return strm.str();
+  }
+  auto size = std::min(lhs.get_size(), rhs.get_size());
+  strm << separator << miss_cnt << " of " << size << " values missed";
+  std::size_t shown_cnt = 0;
+  for (std::size_t idx = 0; idx < size && shown_cnt < max_shown; ++idx) {
+    if (!test_range_elem<op>(lhs[idx], rhs[idx])) {
+      strm
+          << separator << '[' << idx << "] "
+          << as_number(lhs[idx]) << " vs " << as_number(rhs[idx]);
+      ++shown_cnt;
+    }
+  }  // for
+  if (miss_cnt > shown_cnt) {
+    strm << separator << "...";
+  }
+  return strm.str();
+}
+
+// What comparing two ranges of floating-point numbers found.
+class ulp_stats_t final {
+public:
+
+  // The number of pairs which the tolerance didn't admit.
+  std::size_t miss_cnt;
+
+  // The greatest distance in ULPs, and the least index at which it occurs.
+  std::uint64_t max_ulps;
+
+  std::size_t worst_idx;
+
+  // The sum of the distances in ULPs, of which the mean is taken.
+  double total_ulps;
+
+};  // ulp_stats_t
+
+// Compares two ranges of floats or doubles pair by pair, using AVX2, SSE2 or
+// plain C++, as count_range_misses() does.
+ulp_stats_t compare_almost_eq(
+    elem_kind_t kind, const tolerance_t &tol, const void *lhs,
+    const void *rhs, std::size_t size) noexcept;
+
+// Describes how two ranges of floats or doubles fail to be almost equal:
+// whether their sizes differ, how many pairs miss, the greatest and mean
+// distances in ULPs, the worst pair, and a histogram of the distances.
+std::string describe_almost_eq(
+    elem_kind_t kind, const tolerance_t &tol, const void *lhs,
+    std::size_t lhs_size, const void *rhs, std::size_t rhs_size);
+
+class predicate_t {
+public:
+
+  using cb_t = std::function<bool (const any_operand_t &)>;
+
+  predicate_t(const predicate_t &) = delete;
+
+  virtual ~predicate_t();
+
+  predicate_t &operator=(const predicate_t &) = delete;
+
+  operator bool() const noexcept {
+    return ok;
+  }
+
+  virtual const char *get_name() const = 0;
+
+  virtual bool for_each_operand(const cb_t &cb) const = 0;
+
+  void write_src(std::ostream &strm) const;
+
+  // Writes whatever the predicate has to say beyond its operands' values,
+  // each part after a separator.  By default, nothing.
+  virtual void write_details(std::ostream &strm) const;
+
+protected:
+
+  explicit predicate_t(bool ok_)
+      : ok(ok_) {}
+
+private:
+
+  bool ok;
+
+};  // predicate_t
+
+writer_t<predicate_t> src_of(const predicate_t &predicate);
+
+inline writer_t<predicate_t> src_of(const predicate_t &predicate) {
+  return { predicate, &predicate_t::write_src };
+}
+
+class unary_t
+    : public predicate_t {
+public:
+
+  virtual bool for_each_operand(const cb_t &cb) const override final;
+
+protected:
+
+  unary_t(bool ok, const any_operand_t &operand_)
+      : predicate_t(ok), operand(operand_) {}
+
+private:
+
+  const any_operand_t &operand;
 
 };  // unary_t
 
@@ -743,201 +2814,1123 @@ class binary_t
     : public predicate_t {
 public:
 
-  virtual bool for_each_operand(const cb_t &cb) const override final;
+  virtual bool for_each_operand(const cb_t &cb) const override final;
+
+protected:
+
+  binary_t(bool ok, const any_operand_t &lhs_, const any_operand_t &rhs_)
+      : predicate_t(ok), lhs(lhs_), rhs(rhs_) {}
+
+private:
+
+  const any_operand_t &lhs, &rhs;
+
+};  // binary_t
+
+class ternary_t
+    : public predicate_t {
+public:
+
+  virtual bool for_each_operand(const cb_t &cb) const override final;
+
+protected:
+
+  ternary_t(
+      bool ok, const any_operand_t &lhs_, const any_operand_t &rhs_,
+      const any_operand_t &coef_)
+      : predicate_t(ok), lhs(lhs_), rhs(rhs_), coef(coef_) {}
+
+private:
+
+  const any_operand_t &lhs, &rhs, &coef;
+
+};  // ternary_t
+
+namespace predicate {
+
+class true_t final
+    : public unary_t {
+public:
+
+  template <typename val_t>
+  static bool test(const val_t &val) {
+    return as_bool(val);
+  }
+
+  true_t(bool ok, const any_operand_t &operand)
+      : unary_t(ok, operand) {}
+
+  virtual const char *get_name() const override;
+
+};  // true_t
+
+class false_t final
+    : public unary_t {
+public:
+
+  template <typename val_t>
+  static bool test(const val_t &val) {
+    return !as_bool(val);
+  }
+
+  false_t(bool ok, const any_operand_t &operand)
+      : unary_t(ok, operand) {}
+
+  virtual const char *get_name() const override;
+
+};  // false_t
+
+class eq_t final
+    : public binary_t {
+public:
+
+  template <typename lhs_t, typename rhs_t>
+  static bool test(const lhs_t &lhs, const rhs_t &rhs) {
+    return eq(lhs, rhs);
+  }
+
+  eq_t(bool ok, const any_operand_t &lhs, const any_operand_t &rhs)
+      : binary_t(ok, lhs, rhs) {}
+
+  virtual const char *get_name() const override;
+
+};  // eq_t
+
+class ne_t final
+    : public binary_t {
+public:
+
+  template <typename lhs_t, typename rhs_t>
+  static bool test(const lhs_t &lhs, const rhs_t &rhs) {
+    return ne(lhs, rhs);
+  }
+
+  ne_t(bool ok, const any_operand_t &lhs, const any_operand_t &rhs)
+      : binary_t(ok, lhs, rhs) {}
+
+  virtual const char *get_name() const override;
+
+};  // ne_t
+
+class lt_t final
+    : public binary_t {
+public:
+
+  template <typename lhs_t, typename rhs_t>
+  static bool test(const lhs_t &lhs, const rhs_t &rhs) {
+    return lt(lhs, rhs);
+  }
+
+  lt_t(bool ok, const any_operand_t &lhs, const any_operand_t &rhs)
+      : binary_t(ok, lhs, rhs) {}
+
+  virtual const char *get_name() const override;
+
+};  // lt_t
+
+class le_t final
+    : public binary_t {
+public:
+
+  template <typename lhs_t, typename rhs_t>
+  static bool test(const lhs_t &lhs, const rhs_t &rhs) {
+    return le(lhs, rhs);
+  }
+
+  le_t(bool ok, const any_operand_t &lhs, const any_operand_t &rhs)
+      : binary_t(ok, lhs, rhs) {}
+
+  virtual const char *get_name() const override;
+
+};  // le_t
+
+class gt_t final
+    : public binary_t {
+public:
+
+  template <typename lhs_t, typename rhs_t>
+  static bool test(const lhs_t &lhs, const rhs_t &rhs) {
+    return gt(lhs, rhs);
+  }
+
+  gt_t(bool ok, const any_operand_t &lhs, const any_operand_t &rhs)
+      : binary_t(ok, lhs, rhs) {}
+
+  virtual const char *get_name() const override;
+
+};  // gt_t
+
+class ge_t final
+    : public binary_t {
+public:
+
+  template <typename lhs_t, typename rhs_t>
+  static bool test(const lhs_t &lhs, const rhs_t &rhs) {
+    return ge(lhs, rhs);
+  }
+
+  ge_t(bool ok, const any_operand_t &lhs, const any_operand_t &rhs)
+      : binary_t(ok, lhs, rhs) {}
+
+  virtual const char *get_name() const override;
+
+};  // ge_t
+
+class almost_eq_t final
+    : public ternary_t {
+public:
+
+  template <typename lhs_t, typename rhs_t, typename coef_t>
+  static bool test(const lhs_t &lhs, const rhs_t &rhs, const coef_t &coef) {
+    return almost_eq(lhs, rhs, coef);
+  }
+
+  almost_eq_t(
+      bool ok, const any_operand_t &lhs, const any_operand_t &rhs,
+      const any_operand_t &coef)
+      : ternary_t(ok, lhs, rhs, coef) {}
+
+  virtual const char *get_name() const override;
+
+};  // almost_eq_t
+
+class not_almost_eq_t final
+    : public ternary_t {
+public:
+
+  template <typename lhs_t, typename rhs_t, typename coef_t>
+  static bool test(const lhs_t &lhs, const rhs_t &rhs, const coef_t &coef) {
+    return !almost_eq(lhs, rhs, coef);
+  }
+
+  not_almost_eq_t(
+      bool ok, const any_operand_t &lhs, const any_operand_t &rhs,
+      const any_operand_t &coef)
+      : ternary_t(ok, lhs, rhs, coef) {}
+
+  virtual const char *get_name() const override;
+
+};  // not_almost_eq_t
+
+class no_alloc_t final
+    : public unary_t {
+public:
+
+  template <typename operand_t>
+  static bool test(const operand_t &operand) {
+    return operand == 0;
+  }
+
+  no_alloc_t(bool ok, const any_operand_t &operand)
+      : unary_t(ok, operand) {}
+
+  virtual const char *get_name() const override;
+
+};  // no_alloc_t
+
+class allocs_le_t final
+    : public binary_t {
+public:
+
+  template <typename lhs_t, typename rhs_t>
+  static bool test(const lhs_t &lhs, const rhs_t &rhs) {
+    return le(lhs, rhs);
+  }
+
+  allocs_le_t(bool ok, const any_operand_t &lhs, const any_operand_t &rhs)
+      : binary_t(ok, lhs, rhs) {}
+
+  virtual const char *get_name() const override;
+
+};  // allocs_le_t
+
+class duration_lt_t final
+    : public binary_t {
+public:
+
+  template <typename budget_t>
+  static bool test(const durations_t &durations, const budget_t &budget) {
+    return durations.get_median() < as_secs(budget);
+  }
+
+  duration_lt_t(
+      bool ok, const any_operand_t &durations, const any_operand_t &budget)
+      : binary_t(ok, durations, budget) {}
+
+  virtual const char *get_name() const override;
+
+};  // duration_lt_t
+
+class percentile_lt_t final
+    : public ternary_t {
+public:
+
+  template <typename pct_t, typename budget_t>
+  static bool test(
+      const durations_t &durations, const pct_t &pct,
+      const budget_t &budget) {
+    return durations.get_percentile(static_cast<double>(pct))
+        < as_secs(budget);
+  }
+
+  percentile_lt_t(
+      bool ok, const any_operand_t &durations, const any_operand_t &pct,
+      const any_operand_t &budget)
+      : ternary_t(ok, durations, pct, budget) {}
+
+  virtual const char *get_name() const override;
+
+};  // percentile_lt_t
+
+class per_op_lt_t final
+    : public ternary_t {
+public:
+
+  template <typename limit_t>
+  static bool test(
+      const counters_t &counters, event_t event, const limit_t &limit) {
+    return !counters.has(event)
+        || counters.get_per_op(event) < static_cast<double>(limit);
+  }
+
+  per_op_lt_t(
+      bool ok, const any_operand_t &counters, const any_operand_t &event,
+      const any_operand_t &limit)
+      : ternary_t(ok, counters, event, limit) {}
+
+  virtual const char *get_name() const override;
+
+};  // per_op_lt_t
+
+// Compares two ranges element by element.  The ranges pass if they're the
+// same size and every pair of values compares as the op says.
+template <range_op_t op>
+class range_t final
+    : public binary_t {
+public:
+
+  template <typename elem_t>
+  static bool test(const span_t<elem_t> &lhs, const span_t<elem_t> &rhs) {
+    static_assert(
+        op != range_op_t::eq || !std::is_floating_point<elem_t>::value,
+        "Don't compare floating-point numbers for equality.");
+    return lhs.get_size() == rhs.get_size()
+        && count_range_misses<op>(lhs, rhs) == 0;
+  }
+
+  template <typename elem_t>
+  range_t(
+      bool ok, const typed_operand_t<span_t<elem_t>> &lhs,
+      const typed_operand_t<span_t<elem_t>> &rhs)
+      : binary_t(ok, lhs, rhs),
+        details(describe_range_misses<op>(lhs.val, rhs.val)) {}
+
+  virtual const char *get_name() const override {
+    switch (op) {
+      case range_op_t::eq: {
+        return "RANGE_EQ";
+      }
+      case range_op_t::lt: {
+        return "RANGE_LT";
+      }
+      case range_op_t::le: {
+        return "RANGE_LE";
+      }
+      case range_op_t::gt: {
+        return "RANGE_GT";
+      }
+      case range_op_t::ge: {
+        return "RANGE_GE";
+      }
+    }
+    return "";
+  }
+
+  virtual void write_details(std::ostream &strm) const override {
+    strm << details;
+  }
+
+private:
+
+  std::string details;
+
+};  // range_t<op>
+
+using range_eq_t = range_t<range_op_t::eq>;
+using range_lt_t = range_t<range_op_t::lt>;
+using range_le_t = range_t<range_op_t::le>;
+using range_gt_t = range_t<range_op_t::gt>;
+using range_ge_t = range_t<range_op_t::ge>;
+
+// Compares two ranges of floats or doubles pair by pair, for being the same
+// size and almost equal within a tolerance.
+class range_almost_eq_t final
+    : public ternary_t {
+public:
+
+  template <typename elem_t, typename tol_t>
+  static bool test(
+      const span_t<elem_t> &lhs, const span_t<elem_t> &rhs,
+      const tol_t &tol) {
+    static constexpr auto kind = get_elem_kind<elem_t>();
+    static_assert(
+        kind == elem_kind_t::f32 || kind == elem_kind_t::f64,
+        "Ranges are almost equal only of float or double.");
+    return lhs.get_size() == rhs.get_size()
+        && compare_almost_eq(
+            kind, as_tolerance(tol), lhs.get_data(), rhs.get_data(),
+            lhs.get_size()).miss_cnt == 0;
+  }
 
-protected:
+  template <typename elem_t, typename tol_t>
+  range_almost_eq_t(
+      bool ok, const typed_operand_t<span_t<elem_t>> &lhs,
+      const typed_operand_t<span_t<elem_t>> &rhs,
+      const typed_operand_t<tol_t> &tol)
+      : ternary_t(ok, lhs, rhs, tol),
+        details(
+            describe_almost_eq(
+                get_elem_kind<elem_t>(), as_tolerance(tol.val),
+                lhs.val.get_data(), lhs.val.get_size(),
+                rhs.val.get_data(), rhs.val.get_size())) {}
 
-  binary_t(bool ok, const any_operand_t &lhs_, const any_operand_t &rhs_)
-      : predicate_t(ok), lhs(lhs_), rhs(rhs_) {}
+  virtual const char *get_name() const override;
+
+  virtual void write_details(std::ostream &strm) const override {
+    strm << details;
+  }
 
 private:
 
-  const any_operand_t &lhs, &rhs;
+  std::string details;
 
-};  // binary_t
+};  // range_almost_eq_t
 
-class ternary_t
-    : public predicate_t {
+}  // predicate
+
+// The outcome of testing a predicate against captured operands.  It holds
+// only the result and the operands, so the passing path of an expectation
+// builds nothing more.  The predicate itself, which knows how to describe the
+// test, is built only if the expectation is to be reported.
+template <typename pred_t, typename... vals_t>
+class check_t final {
 public:
 
-  virtual bool for_each_operand(const cb_t &cb) const override final;
+  explicit check_t(const operand_t<vals_t> &... operands_)
+      : operands(operands_...), ok(pred_t::test(operands_.val...)) {}
 
-protected:
+  operator bool() const noexcept {
+    return ok;
+  }
 
-  ternary_t(
-      bool ok, const any_operand_t &lhs_, const any_operand_t &rhs_,
-      const any_operand_t &coef_)
-      : predicate_t(ok), lhs(lhs_), rhs(rhs_), coef(coef_) {}
+  // Builds the predicate, passes it to the callback, and returns whatever
+  // the callback returns.
+  template <typename cb_t>
+  auto with_predicate(const cb_t &cb) const
+      -> decltype(cb(std::declval<const predicate_t &>())) {
+    return with_predicate(cb, std::index_sequence_for<vals_t...> {});
+  }
 
 private:
 
-  const any_operand_t &lhs, &rhs, &coef;
+  template <typename cb_t, std::size_t... idxs>
+  auto with_predicate(const cb_t &cb, std::index_sequence<idxs...>) const
+      -> decltype(cb(std::declval<const predicate_t &>())) {
+    return cb(
+        pred_t { ok, typed_operand_t<vals_t> { std::get<idxs>(operands) }... });
+  }
 
-};  // ternary_t
+  std::tuple<operand_t<vals_t>...> operands;
 
-namespace predicate {
+  bool ok;
 
-class true_t final
-    : public unary_t {
+};  // check_t<pred_t, vals_t...>
+
+template <typename pred_t, typename... vals_t>
+check_t<pred_t, vals_t...> check(const operand_t<vals_t> &... operands) {
+  return check_t<pred_t, vals_t...> { operands... };
+}
+
+// A report of an expectation under construction.  See expectation_t.
+class report_t;
+
+class expectation_t final {
 public:
 
-  template <typename val_t>
-  explicit true_t(const operand_t<val_t> &operand)
-      : unary_t(as_bool(operand.val), operand) {}
+  // A passing expectation costs its test and one branch, as long as no run
+  // shows passes.  Only a failing one, or a passing one when passes may be
+  // shown, goes on to begin a report, which decides whether to report.
+  template <typename pred_t, typename... vals_t>
+  expectation_t(const loc_t &loc, const check_t<pred_t, vals_t...> &check)
+      : report(nullptr), ok(check) {
+    if (LICK_UNLIKELY(!ok || ctxt_t::may_show_passes())) {
+      report = check.with_predicate(
+        [loc](const predicate_t &predicate) {
+          return begin_report(loc, predicate);
+        }
+      );
+    }
+  }
 
-  virtual const char *get_name() const override;
+  expectation_t(const expectation_t &) = delete;
 
-};  // true_t
+  ~expectation_t() {
+    if (LICK_UNLIKELY(report != nullptr)) {
+      end_report(report);
+    }
+  }
 
-class false_t final
-    : public unary_t {
-public:
+  expectation_t &operator=(const expectation_t &) = delete;
+
+  operator bool() const noexcept {
+    return ok;
+  }
 
   template <typename val_t>
-  explicit false_t(const operand_t<val_t> &operand)
-      : unary_t(!as_bool(operand.val), operand) {}
+  expectation_t &operator<<(const val_t &val) {
+    if (LICK_UNLIKELY(report != nullptr)) {
+      write(get_extra_strm(report), val);
+    }
+    return *this;
+  }
 
-  virtual const char *get_name() const override;
+private:
 
-};  // false_t
+  // These take and return the report rather than working through 'this', so
+  // that a passing expectation never has its address taken and can live
+  // entirely in registers.  begin_report() returns null for a pass which the
+  // calling thread's context hides.
 
-class eq_t final
-    : public binary_t {
-public:
+  LICK_COLD static report_t *begin_report(
+      loc_t loc, const predicate_t &predicate);
 
-  template <typename lhs_t, typename rhs_t>
-  eq_t(const operand_t<lhs_t> &lhs, const operand_t<rhs_t> &rhs)
-      : binary_t(eq(lhs.val, rhs.val), lhs, rhs) {}
+  LICK_COLD static void end_report(report_t *report) noexcept;
 
-  virtual const char *get_name() const override;
+  static std::ostream &get_extra_strm(report_t *report);
 
-};  // eq_t
+  report_t *report;
 
-class ne_t final
-    : public binary_t {
+  bool ok;
+
+};  // expectation_t
+
+// A region of code whose allocations are counted and checked against a
+// limit.  See EXPECT_NO_ALLOC and EXPECT_ALLOCS_LE.
+class alloc_region_t final {
 public:
 
-  template <typename lhs_t, typename rhs_t>
-  ne_t(const operand_t<lhs_t> &lhs, const operand_t<rhs_t> &rhs)
-      : binary_t(ne(lhs.val, rhs.val), lhs, rhs) {}
+  // With no limit source, the region may not allocate at all.
+  explicit alloc_region_t(
+      const loc_t &loc, const char *limit_src = nullptr,
+      std::size_t limit = 0) noexcept;
 
-  virtual const char *get_name() const override;
+  alloc_region_t(const alloc_region_t &) = delete;
 
-};  // ne_t
+  ~alloc_region_t();
 
-class lt_t final
-    : public binary_t {
+  alloc_region_t &operator=(const alloc_region_t &) = delete;
+
+  // True the first time, so that the body of the region runs once, and
+  // false the second, after checking what the body allocated.
+  bool loop() {
+    if (!done) {
+      done = true;
+      return true;
+    }
+    check();
+    return false;
+  }
+
+private:
+
+  void check();
+
+  loc_t loc;
+
+  const char *limit_src;
+
+  std::size_t limit;
+
+  // The thread's allocation count and bytes when the region began.
+  std::size_t start_cnt, start_bytes;
+
+  // Whether the thread's allocations were being counted before the region.
+  bool was_on;
+
+  bool done;
+
+};  // alloc_region_t
+
+// Generators of the random values which a property is checked against.  A
+// generator has a val_t, the type of its values, and these members:
+//   val_t operator()(rng_t &rng, std::size_t size) const;
+//     Makes a random value.  The size grows from 1 to 100 over the cases of
+//     a property, so that the early cases are small.
+//   std::vector<val_t> shrink(const val_t &val) const;
+//     Makes values simpler than the given one, the simplest first.
+//   void write(std::ostream &strm, const val_t &val) const;
+//     Writes a value, as it would appear in source code.
+// Generators are shared between threads, so their members must not change
+// their state.
+namespace gen {
+
+// A small, fast random number generator (SplitMix64), cheap enough to seed
+// afresh for each case.
+class rng_t final {
 public:
 
-  template <typename lhs_t, typename rhs_t>
-  lt_t(const operand_t<lhs_t> &lhs, const operand_t<rhs_t> &rhs)
-      : binary_t(lt(lhs.val, rhs.val), lhs, rhs) {}
+  explicit rng_t(std::uint64_t state_) noexcept
+      : state(state_) {}
 
-  virtual const char *get_name() const override;
+  std::uint64_t operator()() noexcept {
+    return mix(state += 0x9e3779b97f4a7c15);
+  }
 
-};  // lt_t
+  // A number in [0, n), or 0 if n is 0.
+  std::uint64_t below(std::uint64_t n) noexcept {
+    return n ? (*this)() % n : 0;
+  }
 
-class le_t final
-    : public binary_t {
+  // A number in [0, 1).
+  double get_unit() noexcept {
+    return static_cast<double>((*this)() >> 11) / 9007199254740992.0;
+  }
+
+  // Scrambles the bits of a number, so that nearby numbers make unrelated
+  // seeds.
+  static std::uint64_t mix(std::uint64_t val) noexcept {
+    val = (val ^ (val >> 30)) * 0xbf58476d1ce4e5b9;
+    val = (val ^ (val >> 27)) * 0x94d049bb133111eb;
+    return val ^ (val >> 31);
+  }
+
+private:
+
+  std::uint64_t state;
+
+};  // rng_t
+
+// Integers in [lo, hi], shrinking toward 0, or toward whichever end of the
+// range is nearer 0.
+template <typename int_t>
+class ints_t final {
 public:
 
-  template <typename lhs_t, typename rhs_t>
-  le_t(const operand_t<lhs_t> &lhs, const operand_t<rhs_t> &rhs)
-      : binary_t(le(lhs.val, rhs.val), lhs, rhs) {}
+  using val_t = int_t;
+
+  ints_t(int_t lo_, int_t hi_)
+      : lo(lo_), hi(hi_) {}
+
+  val_t operator()(rng_t &rng, std::size_t) const {
+    /* The ends of the range, and its origin, break code more than other
+       values do, so they come up one case in eight. */
+    switch (rng.below(16)) {
+      case 0: {
+        return lo;
+      }
+      case 1: {
+        return hi;
+      }
+      default: {
+        break;
+      }
+    }
+    auto span = to_bits(hi) - to_bits(lo);
+    auto offset = (span == std::numeric_limits<std::uint64_t>::max())
+        ? rng() : rng.below(span + 1);
+    return from_bits(to_bits(lo) + offset);
+  }
 
-  virtual const char *get_name() const override;
+  // The origin, then values which step from the given one toward the
+  // origin by half the distance, then a quarter, and so on down to 1.
+  std::vector<val_t> shrink(const val_t &val) const {
+    std::vector<val_t> vals;
+    auto origin = get_origin();
+    if (val == origin) {
+      return vals;
+    }
+    vals.push_back(origin);
+    bool falls = (val > origin);
+    auto dist = falls
+        ? to_bits(val) - to_bits(origin) : to_bits(origin) - to_bits(val);
+    for (auto step = dist / 2; step; step /= 2) {
+      vals.push_back(
+          from_bits(falls ? to_bits(val) - step : to_bits(val) + step));
+    }
+    return vals;
+  }
 
-};  // le_t
+  void write(std::ostream &strm, const val_t &val) const {
+    /* Promote character types, so they're written as numbers. */
+    strm << +val;
+  }
 
-class gt_t final
-    : public binary_t {
+private:
+
+  val_t get_origin() const noexcept {
+    return (lo > 0) ? lo : (hi < 0) ? hi : 0;
+  }
+
+  // Maps the range of int_t onto unsigned numbers in the same order, so that
+  // distances don't overflow.
+  static std::uint64_t to_bits(int_t val) noexcept {
+    return std::is_signed<int_t>::value
+        ? static_cast<std::uint64_t>(static_cast<std::int64_t>(val))
+            ^ 0x8000000000000000
+        : static_cast<std::uint64_t>(val);
+  }
+
+  static int_t from_bits(std::uint64_t bits) noexcept {
+    return std::is_signed<int_t>::value
+        ? static_cast<int_t>(
+            static_cast<std::int64_t>(bits ^ 0x8000000000000000))
+        : static_cast<int_t>(bits);
+  }
+
+  int_t lo, hi;
+
+};  // ints_t<int_t>
+
+// Floating-point numbers in [lo, hi], shrinking toward 0, or toward
+// whichever end of the range is nearer 0, and toward whole numbers.
+template <typename float_t>
+class floats_t final {
 public:
 
-  template <typename lhs_t, typename rhs_t>
-  gt_t(const operand_t<lhs_t> &lhs, const operand_t<rhs_t> &rhs)
-      : binary_t(gt(lhs.val, rhs.val), lhs, rhs) {}
+  using val_t = float_t;
+
+  floats_t(float_t lo_, float_t hi_)
+      : lo(lo_), hi(hi_) {}
+
+  val_t operator()(rng_t &rng, std::size_t) const {
+    switch (rng.below(16)) {
+      case 0: {
+        return lo;
+      }
+      case 1: {
+        return hi;
+      }
+      case 2: {
+        return get_origin();
+      }
+      default: {
+        break;
+      }
+    }
+    /* Mixing the ends, rather than scaling their difference, can't
+       overflow. */
+    auto unit = static_cast<float_t>(rng.get_unit());
+    auto val = lo * (1 - unit) + hi * unit;
+    return (val < lo) ? lo : (val > hi) ? hi : val;
+  }
 
-  virtual const char *get_name() const override;
+  // The origin, the given value without its fraction, and the value
+  // halfway to the origin.
+  std::vector<val_t> shrink(const val_t &val) const {
+    std::vector<val_t> vals;
+    auto origin = get_origin();
+    if (!(val != origin)) {
+      return vals;
+    }
+    vals.push_back(origin);
+    auto whole = std::trunc(val);
+    if (whole != val && whole != origin) {
+      vals.push_back(whole);
+    }
+    auto half = origin + (val - origin) / 2;
+    if (half != val && half != origin && half != whole) {
+      vals.push_back(half);
+    }
+    return vals;
+  }
 
-};  // gt_t
+  void write(std::ostream &strm, const val_t &val) const {
+    std::ostringstream text;
+    text.precision(std::numeric_limits<float_t>::max_digits10);
+    text << val;
+    strm << text.str();
+  }
 
-class ge_t final
-    : public binary_t {
+private:
+
+  val_t get_origin() const noexcept {
+    return (lo > 0) ? lo : (hi < 0) ? hi : 0;
+  }
+
+  float_t lo, hi;
+
+};  // floats_t<float_t>
+
+// Containers of values from another generator, holding no more than a given
+// number of them.  A container shrinks by losing elements, then by shrinking
+// them.
+template <typename container_t, typename elem_gen_t>
+class containers_t final {
 public:
 
-  template <typename lhs_t, typename rhs_t>
-  ge_t(const operand_t<lhs_t> &lhs, const operand_t<rhs_t> &rhs)
-      : binary_t(ge(lhs.val, rhs.val), lhs, rhs) {}
+  using val_t = container_t;
 
-  virtual const char *get_name() const override;
+  containers_t(elem_gen_t elem_gen_, std::size_t max_size_)
+      : elem_gen(std::move(elem_gen_)), max_size(max_size_) {}
 
-};  // ge_t
+  val_t operator()(rng_t &rng, std::size_t size) const {
+    std::vector<elem_t> elems;
+    auto elem_cnt = rng.below((max_size * size + 99) / 100 + 1);
+    for (std::uint64_t i = 0; i < elem_cnt; ++i) {
+      elems.push_back(elem_gen(rng, size));
+    }
+    return val_t(elems.begin(), elems.end());
+  }
 
-class almost_eq_t final
-    : public ternary_t {
+  // Empty, then without runs of half the elements, a quarter, and so on down
+  // to single elements, then with one element shrunk.
+  std::vector<val_t> shrink(const val_t &val) const {
+    std::vector<val_t> vals;
+    std::vector<elem_t> elems(std::begin(val), std::end(val));
+    if (elems.empty()) {
+      return vals;
+    }
+    vals.emplace_back();
+    for (auto run = elems.size() / 2; run; run /= 2) {
+      for (std::size_t start = 0; start < elems.size(); start += run) {
+        auto stop = std::min(start + run, elems.size());
+        std::vector<elem_t> kept(elems.begin(), elems.begin() + start);
+        kept.insert(kept.end(), elems.begin() + stop, elems.end());
+        vals.emplace_back(kept.begin(), kept.end());
+      }  // for
+    }  // for
+    for (std::size_t idx = 0; idx < elems.size(); ++idx) {
+      for (auto &elem : elem_gen.shrink(elems[idx])) {
+        auto changed = elems;
+        changed[idx] = std::move(elem);
+        vals.emplace_back(changed.begin(), changed.end());
+      }  // for
+    }  // for
+    return vals;
+  }
+
+  void write(std::ostream &strm, const val_t &val) const {
+    strm << '{';
+    const char *sep = " ";
+    for (const auto &elem : val) {
+      strm << sep;
+      elem_gen.write(strm, elem);
+      sep = ", ";
+    }
+    strm << (*sep == ',' ? " }" : "}");
+  }
+
+private:
+
+  using elem_t = typename elem_gen_t::val_t;
+
+  elem_gen_t elem_gen;
+
+  std::size_t max_size;
+
+};  // containers_t<container_t, elem_gen_t>
+
+// Strings of characters from an alphabet, no longer than a given length.  A
+// string shrinks by losing characters, then by turning them into the first
+// character of the alphabet.
+class strings_t final {
 public:
 
-  template <typename lhs_t, typename rhs_t, typename coef_t>
-  almost_eq_t(
-      const operand_t<lhs_t> &lhs, const operand_t<rhs_t> &rhs,
-      const operand_t<coef_t> &coef)
-      : ternary_t(almost_eq(lhs.val, rhs.val, coef.val), lhs, rhs, coef) {}
+  using val_t = std::string;
 
-  virtual const char *get_name() const override;
+  strings_t(std::size_t max_size, std::string alphabet);
 
-};  // almost_eq_t
+  val_t operator()(rng_t &rng, std::size_t size) const;
 
-class not_almost_eq_t final
-    : public ternary_t {
+  std::vector<val_t> shrink(const val_t &val) const;
+
+  void write(std::ostream &strm, const val_t &val) const;
+
+private:
+
+  std::size_t max_size;
+
+  std::string alphabet;
+
+};  // strings_t
+
+// The whole range of int_t, by default.
+template <typename int_t = int>
+ints_t<int_t> ints(
+    int_t lo = std::numeric_limits<int_t>::min(),
+    int_t hi = std::numeric_limits<int_t>::max()) {
+  return { lo, hi };
+}
+
+template <typename float_t = double>
+floats_t<float_t> floats(float_t lo = -1e9, float_t hi = 1e9) {
+  return { lo, hi };
+}
+
+// Printable ASCII characters, by default.
+strings_t strings(std::size_t max_size = 32, std::string alphabet = "");
+
+template <typename container_t, typename elem_gen_t>
+containers_t<container_t, elem_gen_t> containers(
+    elem_gen_t elem_gen, std::size_t max_size = 32) {
+  return { std::move(elem_gen), max_size };
+}
+
+template <typename elem_gen_t>
+containers_t<std::vector<typename elem_gen_t::val_t>, elem_gen_t> vectors(
+    elem_gen_t elem_gen, std::size_t max_size = 32) {
+  return { std::move(elem_gen), max_size };
+}
+
+}  // gen
+
+// Stands in for the parameters of a property beyond those it has.
+class nothing_t final {};
+
+// The type of the idx-th value of a property with the given tuple of
+// generators, or nothing_t if it hasn't that many.
+template <typename gens_t, std::size_t idx, typename = void>
+class arg_of final {
 public:
 
-  template <typename lhs_t, typename rhs_t, typename coef_t>
-  not_almost_eq_t(
-      const operand_t<lhs_t> &lhs, const operand_t<rhs_t> &rhs,
-      const operand_t<coef_t> &coef)
-      : ternary_t(!almost_eq(lhs.val, rhs.val, coef.val), lhs, rhs, coef) {}
+  using type = nothing_t;
 
-  virtual const char *get_name() const override;
+};  // arg_of<gens_t, idx>
 
-};  // not_almost_eq_t
+template <typename gens_t, std::size_t idx>
+class arg_of<
+    gens_t, idx,
+    typename std::enable_if<(idx < std::tuple_size<gens_t>::value)>::type>
+    final {
+public:
 
-}  // predicate
+  using type = typename std::tuple_element<idx, gens_t>::type::val_t;
 
-class expectation_t final {
+};  // arg_of<gens_t, idx>
+
+template <typename gens_t, std::size_t idx>
+using arg_of_t = typename arg_of<gens_t, idx>::type;
+
+// Runs the cases of a property and reports on them.  This is the part of a
+// property which doesn't depend on its generators; see check_property().
+class property_t final {
 public:
 
-  expectation_t(const loc_t &loc, const predicate_t &predicate);
+  using run_t = std::function<void (std::size_t)>;
 
-  expectation_t(const expectation_t &) = delete;
+  // Takes its seed and number of cases from the current fixture.
+  explicit property_t(const loc_t &loc);
 
-  ~expectation_t();
+  property_t(const property_t &) = delete;
 
-  expectation_t &operator=(const expectation_t &) = delete;
+  ~property_t();
 
-  operator bool() const noexcept {
-    return ok;
+  property_t &operator=(const property_t &) = delete;
+
+  std::uint64_t get_seed() const noexcept {
+    return seed;
   }
 
-  template <typename val_t>
-  expectation_t &operator<<(const val_t &val) {
-    write(string_builder, val);
-    return *this;
+  std::size_t get_case_cnt() const noexcept {
+    return case_cnt;
   }
 
+  // Returns the least index in [0, cnt) at which running fails an
+  // expectation or throws, or cnt if none does.  The runs are spread across
+  // as many threads as the jobs allow, are quiet, and don't count against
+  // the fixture.  The threads last as long as the property, so that each
+  // round of shrinking reuses them.
+  std::size_t find_failure(std::size_t cnt, const run_t &run) const;
+
+  void pass() const;
+
+  // Reports the failing case, after its values have shrunk.
+  void fail(
+      std::size_t case_idx, std::size_t shrink_cnt,
+      const std::string &vals) const;
+
 private:
 
-  std::ostringstream string_builder;
+  class crew_t;
 
   loc_t loc;
 
-  const predicate_t &predicate;
+  // The seed of this property, which is the seed of the run mixed with the
+  // fixture's name, and that of the run, to report.
+  std::uint64_t seed, run_seed;
 
-  bool ok;
+  std::size_t case_cnt;
 
-};  // expectation_t
+  std::unique_ptr<crew_t> crew;
+
+};  // property_t
+
+template <typename gens_t, std::size_t... idxs>
+auto generate(
+    const gens_t &gens, gen::rng_t &rng, std::size_t size,
+    std::index_sequence<idxs...>) {
+  /* Brace initialization makes the generators run in order. */
+  return std::tuple<typename std::tuple_element<idxs, gens_t>::type::val_t...>
+      { std::get<idxs>(gens)(rng, size)... };
+}
+
+// The values of the given case of a property.
+template <typename gens_t>
+auto generate(
+    const gens_t &gens, std::uint64_t seed, std::size_t case_idx,
+    std::size_t case_cnt) {
+  gen::rng_t rng { gen::rng_t::mix(seed ^ gen::rng_t::mix(case_idx)) };
+  auto size = 1 + case_idx * 99 / ((case_cnt > 1) ? case_cnt - 1 : 1);
+  return generate(
+      gens, rng, size,
+      std::make_index_sequence<std::tuple_size<gens_t>::value>());
+}
+
+template <std::size_t idx, typename vals_t>
+const typename std::tuple_element<idx, vals_t>::type &get_arg(
+    const vals_t &vals, std::true_type) {
+  return std::get<idx>(vals);
+}
+
+template <std::size_t idx, typename vals_t>
+nothing_t get_arg(const vals_t &, std::false_type) {
+  return {};
+}
+
+template <std::size_t idx, typename vals_t>
+decltype(auto) get_arg(const vals_t &vals) {
+  return get_arg<idx>(
+      vals,
+      std::integral_constant<
+          bool, (idx < std::tuple_size<vals_t>::value)>());
+}
+
+template <typename fn_t, typename vals_t>
+void call_with(fn_t fn, const vals_t &vals) {
+  fn(get_arg<0>(vals), get_arg<1>(vals), get_arg<2>(vals), get_arg<3>(vals));
+}
+
+// Appends to the given vector each simpler version of the values, in which
+// one value has been shrunk and the others left alone.
+template <std::size_t idx, typename gens_t, typename vals_t>
+void shrink(const gens_t &gens, const vals_t &vals, std::vector<vals_t> &out) {
+  for (auto &val : std::get<idx>(gens).shrink(std::get<idx>(vals))) {
+    out.push_back(vals);
+    std::get<idx>(out.back()) = std::move(val);
+  }
+}
+
+template <typename gens_t, typename vals_t, std::size_t... idxs>
+std::vector<vals_t> shrink(
+    const gens_t &gens, const vals_t &vals, std::index_sequence<idxs...>) {
+  std::vector<vals_t> out;
+  using expand_t = int[];
+  (void)expand_t { 0, (shrink<idxs>(gens, vals, out), 0)... };
+  return out;
+}
+
+template <typename gens_t, typename vals_t, std::size_t... idxs>
+std::string write_args(
+    const gens_t &gens, const vals_t &vals, std::index_sequence<idxs...>) {
+  std::ostringstream strm;
+  using expand_t = int[];
+  (void)expand_t {
+    0,
+    (strm << (idxs ? "; " : "") << "arg" << idxs << '=',
+     std::get<idxs>(gens).write(strm, std::get<idxs>(vals)), 0)...
+  };
+  return strm.str();
+}
+
+// Checks a property, as declared by PROPERTY: runs the function on values
+// made by the generators, and if any case fails, shrinks its values for as
+// long as they keep failing, reports the simplest, and reruns the function
+// on them, so that its failing expectations are reported as usual.
+template <typename gens_t, typename fn_t>
+void check_property(const loc_t &loc, const gens_t &gens, fn_t fn) {
+  using idxs_t = std::make_index_sequence<std::tuple_size<gens_t>::value>;
+  static constexpr std::size_t max_shrink_cnt = 1000;
+  property_t property { loc };
+  auto seed = property.get_seed();
+  auto case_cnt = property.get_case_cnt();
+  auto case_idx = property.find_failure(
+    case_cnt,
+    [&](std::size_t idx) {
+      call_with(fn, generate(gens, seed, idx, case_cnt));
+    }
+  );
+  if (case_idx == case_cnt) {
+    property.pass();
+    return;
+  }
+  auto vals = generate(gens, seed, case_idx, case_cnt);
+  std::size_t shrink_cnt = 0;
+  for (; shrink_cnt < max_shrink_cnt; ++shrink_cnt) {
+    auto simpler = shrink(gens, vals, idxs_t());
+    auto simpler_idx = property.find_failure(
+      simpler.size(),
+      [&](std::size_t idx) {
+        call_with(fn, simpler[idx]);
+      }
+    );
+    if (simpler_idx == simpler.size()) {
+      break;
+    }
+    vals = std::move(simpler[simpler_idx]);
+  }  // for
+  property.fail(case_idx, shrink_cnt, write_args(gens, vals, idxs_t()));
+  call_with(fn, vals);
+}
 
 bool run_fixtures(const cfg_t &cfg);
 
 int main(int argc, char *argv[]);
 
+// The following are shared with the drivers built from this repo, such as
+// lick-run, which build lick.cc with LICK_NO_MAIN.
+
+// The monotonic wall-clock time, in seconds.
+double get_wall_time();
+
+// Describes how a child ended, as reported by waitpid().
+std::string get_status_msg(int status);
+
+// Writes a file by writing a temporary file beside it and then renaming that
+// into place, so that a reader never sees half a file.
+void replace_file(
+    const std::string &path, const std::function<void (std::ostream &)> &fn);
+
+// The wall-clock times which things, such as fixtures, took when they last
+// ran, by name.  The file holds one line per name, giving the time in seconds
+// and then the name.
+class history_t final {
+public:
+
+  history_t() = default;
+
+  history_t(const history_t &) = delete;
+
+  history_t &operator=(const history_t &) = delete;
+
+  // The time the thing last took, or 0 if it has never run.
+  double get(const std::string &name) const {
+    auto iter = walls.find(name);
+    return (iter != walls.end()) ? iter->second : 0;
+  }
+
+  void set(const std::string &name, double wall) {
+    walls[name] = wall;
+  }
+
+  // Loads the file at the path, if there is one.
+  void load(const std::string &path);
+
+  void save(const std::string &path) const;
+
+private:
+
+  std::map<std::string, double> walls;
+
+};  // history_t
+
 }  // lick